@@ -0,0 +1,524 @@
+// ==========================================
+// Benchmark dei percorsi caldi del nodo
+// Genera una chain sintetica (dimensione e mix di azioni configurabili) in
+// una cartella di lavoro, poi misura mining, serializzazione, sha256_hash,
+// firme ECDSA, verifyFullChain, rebuild_state_from_chain (e il rilascio dello
+// stato ricostruito) e load_blockchain.
+// Output: una riga JSON per operazione (throughput e percentili di latenza),
+// pensata per essere confrontata tra una release e l'altra.
+// Uso: ./wwyl_bench [--blocks N] [--users N] [--batch N] [--mix post=30,...]
+//                   [--block-time S] [--repeat N] [--samples N] [--seed N]
+//                   [--threads N] [--miner-threads N] [--dir PATH] [--verbose]
+// ==========================================
+#define _POSIX_C_SOURCE 200809L
+
+#include "wwyl.h"
+#include "utils.h"
+#include "wwyl_crypto.h"
+#include "wwyl_config.h"
+#include "user.h"
+#include "post_state.h"
+#include "ledger.h"
+#include "verify.h"
+#include "miner.h"
+#include "batch.h"
+#include "sha256.h"
+#include "mmr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MAX_USERS 64
+#define BENCH_FUNDING 1000      // Token trasferiti da GOD a ogni utente sintetico
+
+// Azioni generabili dal mix (reveal e finalize dipendono dall'orologio reale)
+enum { MIX_POST, MIX_COMMENT, MIX_VOTE, MIX_FOLLOW, MIX_TRANSFER, MIX_KINDS };
+static const char *mix_names[MIX_KINDS] = { "post", "comment", "vote", "follow", "transfer" };
+
+typedef struct {
+    char priv[SIGNATURE_LEN];
+    char pub[SIGNATURE_LEN];
+    SignSession *session;
+} BenchUser;
+
+typedef struct {
+    const char *name;
+    double *samples;    // Latenze in secondi
+    long count;
+    long cap;
+    long items;         // Unità di lavoro per campione (blocchi per le operazioni sull'intera chain)
+} BenchOp;
+
+static FILE *out;
+static BenchUser users[BENCH_MAX_USERS + 1];   // users[0] = GOD
+static int user_count = 16;
+static int mix_weight[MIX_KINDS] = { 30, 30, 20, 10, 10 };
+static int mix_total = 100;
+static int *posts;
+static int post_count;
+static uint32_t rng_state = 42;
+static long action_seq;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+// xorshift32: la stessa chain (a parte chiavi e firme) a parità di seed
+static uint32_t bench_rand(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// ---------------------------------------------------------
+// CAMPIONI E REPORT
+// ---------------------------------------------------------
+static void op_init(BenchOp *op, const char *name, long cap, long items) {
+    op->name = name;
+    op->samples = (double *)safe_zalloc((size_t)cap * sizeof(double));
+    op->count = 0;
+    op->cap = cap;
+    op->items = items;
+}
+
+static void op_add(BenchOp *op, double secs) {
+    if (op->count < op->cap) op->samples[op->count++] = secs;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile nearest-rank, in microsecondi (campioni già ordinati)
+static double percentile_us(const BenchOp *op, double p) {
+    long rank = (long)(p / 100.0 * (double)op->count + 0.999999);
+    if (rank < 1) rank = 1;
+    return op->samples[rank - 1] * 1e6;
+}
+
+static void op_report(BenchOp *op) {
+    if (op->count == 0) return;
+    double total = 0;
+    for (long i = 0; i < op->count; i++) total += op->samples[i];
+    qsort(op->samples, (size_t)op->count, sizeof(double), cmp_double);
+
+    fprintf(out, "{\"op\":\"%s\",\"samples\":%ld,\"total_s\":%.6f,\"ops_per_s\":%.2f", op->name, op->count, total,
+            total > 0 ? (double)op->count / total : 0.0);
+    if (op->items > 1) {
+        fprintf(out, ",\"blocks\":%ld,\"blocks_per_s\":%.2f", op->items,
+                total > 0 ? (double)(op->count * op->items) / total : 0.0);
+    }
+    fprintf(out, ",\"mean_us\":%.2f,\"min_us\":%.2f,\"p50_us\":%.2f,\"p90_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f}\n",
+            total / (double)op->count * 1e6, op->samples[0] * 1e6, percentile_us(op, 50), percentile_us(op, 90),
+            percentile_us(op, 99), op->samples[op->count - 1] * 1e6);
+    fflush(out);
+    free(op->samples);
+}
+
+// ---------------------------------------------------------
+// GENERAZIONE DELLE AZIONI
+// ---------------------------------------------------------
+static int parse_mix(const char *spec) {
+    int weights[MIX_KINDS] = {0};
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return 0;
+        *eq = '\0';
+        int k = 0;
+        while (k < MIX_KINDS && strcmp(tok, mix_names[k]) != 0) k++;
+        if (k == MIX_KINDS || atoi(eq + 1) < 0) return 0;
+        weights[k] = atoi(eq + 1);
+    }
+    mix_total = 0;
+    for (int k = 0; k < MIX_KINDS; k++) {
+        mix_weight[k] = weights[k];
+        mix_total += weights[k];
+    }
+    return mix_total > 0;
+}
+
+static int pick_kind(void) {
+    int r = (int)(bench_rand() % (uint32_t)mix_total);
+    for (int k = 0; k < MIX_KINDS; k++) {
+        if (r < mix_weight[k]) return k;
+        r -= mix_weight[k];
+    }
+    return MIX_POST;
+}
+
+static int random_other_user(int self) {
+    int u = 1 + (int)(bench_rand() % (uint32_t)(user_count - 1));
+    return u >= self ? u + 1 : u;
+}
+
+static void set_sender(Action *a, ActionType type, int user) {
+    memset(a, 0, sizeof(*a));
+    a->type = type;
+    snprintf(a->sender_pubkey, sizeof(a->sender_pubkey), "%s", users[user].pub);
+}
+
+// Setup: ogni utente si registra, poi GOD gli trasferisce BENCH_FUNDING token
+static void setup_action(Action *a, long step) {
+    int user = 1 + (int)(step % user_count);
+    if (step < user_count) {
+        set_sender(a, ACT_REGISTER_USER, user);
+        snprintf(a->data.registration.username, sizeof(a->data.registration.username), "bench%d", user);
+        snprintf(a->data.registration.bio, sizeof(a->data.registration.bio), "Synthetic user #%d", user);
+        snprintf(a->data.registration.pic_url, sizeof(a->data.registration.pic_url), "bench%d.png", user);
+    } else {
+        set_sender(a, ACT_TRANSFER, 0);
+        snprintf(a->data.transfer.target_pubkey, sizeof(a->data.transfer.target_pubkey), "%s", users[user].pub);
+        a->data.transfer.amount = BENCH_FUNDING;
+    }
+}
+
+// In un batch sono vietati più post e azioni duplicate (vedi batch_merkle_root)
+static int batch_has(const Action *batch, int filled, ActionType type, const char *sender, const char *target) {
+    for (int i = 0; i < filled; i++) {
+        if (batch[i].type != type) continue;
+        if (type == ACT_POST_CONTENT) return 1;
+        if (strcmp(batch[i].sender_pubkey, sender) == 0 &&
+            strcmp(batch[i].data.follow.target_user_pubkey, target) == 0) return 1;
+    }
+    return 0;
+}
+
+static void mix_action(Action *a, const Action *batch, int filled) {
+    int kind = pick_kind();
+    int user = 1 + (int)(bench_rand() % (uint32_t)user_count);
+    long seq = action_seq++;
+
+    // Commenti e voti servono un post già minato; un solo post per batch
+    if ((kind == MIX_COMMENT || kind == MIX_VOTE) && post_count == 0) kind = MIX_POST;
+    if (kind == MIX_POST && batch_has(batch, filled, ACT_POST_CONTENT, NULL, NULL)) {
+        kind = post_count > 0 ? MIX_COMMENT : MIX_TRANSFER;
+    }
+
+    if (kind == MIX_POST) {
+        set_sender(a, ACT_POST_CONTENT, user);
+        snprintf(a->data.post.content, sizeof(a->data.post.content),
+                 "Synthetic post %ld: what would you like to see on this chain next?", seq);
+    } else if (kind == MIX_COMMENT) {
+        set_sender(a, ACT_POST_COMMENT, user);
+        a->data.comment.target_post_id = posts[bench_rand() % (uint32_t)post_count];
+        snprintf(a->data.comment.content, sizeof(a->data.comment.content), "Synthetic comment %ld", seq);
+    } else if (kind == MIX_VOTE) {
+        char secret[64];
+        set_sender(a, ACT_VOTE_COMMIT, user);
+        a->data.commit.target_post_id = posts[bench_rand() % (uint32_t)post_count];
+        snprintf(secret, sizeof(secret), "%d:%ld", a->data.commit.target_post_id, seq);
+        sha256_raw(secret, strlen(secret), a->data.commit.vote_hash);
+    } else if (kind == MIX_FOLLOW) {
+        set_sender(a, ACT_FOLLOW_USER, user);
+        snprintf(a->data.follow.target_user_pubkey, sizeof(a->data.follow.target_user_pubkey), "%s",
+                 users[random_other_user(user)].pub);
+        // Lo stesso follow due volte nel batch sarebbe un duplicato: diventa un trasferimento
+        if (batch_has(batch, filled, ACT_FOLLOW_USER, a->sender_pubkey, a->data.follow.target_user_pubkey)) {
+            kind = MIX_TRANSFER;
+        }
+    }
+    if (kind == MIX_TRANSFER) {
+        set_sender(a, ACT_TRANSFER, user);
+        snprintf(a->data.transfer.target_pubkey, sizeof(a->data.transfer.target_pubkey), "%s",
+                 users[random_other_user(user)].pub);
+        a->data.transfer.amount = 1 + (int)(seq % MAX_BLOCK_ACTIONS);   // Distinti dentro un batch
+    }
+}
+
+static int user_of(const char *pub) {
+    for (int i = 0; i <= user_count; i++) {
+        if (strcmp(users[i].pub, pub) == 0) return i;
+    }
+    fatal_error("Mittente sconosciuto nel benchmark.");
+    return -1;
+}
+
+// ---------------------------------------------------------
+// MINING DELLA CHAIN SINTETICA
+// ---------------------------------------------------------
+// Stesse fasi del miner in background; i timestamp avanzano di block_time
+// secondi per blocco, così il retarget si comporta come su una chain reale.
+// Finiscono presto oltre POW_MAX_FUTURE_DRIFT: il Makefile lo allarga.
+static Block *bench_mine(Block *tail, Action *actions, int count, int block_time) {
+    Block *b;
+    SignSession *signer;
+    if (count == 1) {
+        b = block_new_action(tail, actions[0].type, &actions[0].data, actions[0].sender_pubkey);
+        signer = users[user_of(actions[0].sender_pubkey)].session;
+    } else {
+        for (int i = 0; i < count; i++) {
+            action_sign(&actions[i], tail->curr_hash, users[user_of(actions[i].sender_pubkey)].session);
+        }
+        b = block_new_batch(tail, actions, count, users[0].pub);
+        signer = users[0].session;
+    }
+    if (!b) fatal_error("Batch sintetico rifiutato al blocco #%d.", tail->index + 1);
+    b->timestamp = tail->timestamp + block_time;
+
+    if (!block_prepare(tail, b) || !block_solve(b, signer) || !block_commit(tail, b)) {
+        fatal_error("Mining del blocco sintetico #%d fallito.", b->index);
+    }
+    state_apply_block(b);
+    if (b->type == ACT_POST_CONTENT) {
+        posts[post_count++] = b->index;
+    } else if (b->type == ACT_BATCH) {
+        for (int i = 0; i < count; i++) {
+            if (b->actions[i].type == ACT_POST_CONTENT) posts[post_count++] = b->index;
+        }
+    }
+    block_free(tail);
+    return b;
+}
+
+// ---------------------------------------------------------
+// RESET DELLO STATO TRA UNA MISURA E L'ALTRA
+// ---------------------------------------------------------
+static void reset_state(void) {
+    state_cleanup();
+    post_index_cleanup();
+    state_init();
+    post_index_init();
+}
+
+static void remove_chain_files(void) {
+    const char *files[] = { CHAIN_FILE, CHAIN_INDEX_FILE, CHAIN_MMR_FILE, CHECKPOINT_FILE,
+                            STATE_SNAPSHOT_FILE, STATE_SNAPSHOT_FILE ".prev" };
+    char seg[64];
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) unlink(files[i]);
+    for (int s = 1; ; s++) {
+        snprintf(seg, sizeof(seg), "%s.%d", CHAIN_FILE, s);
+        if (unlink(seg) != 0) break;
+    }
+}
+
+static int arg_int(int argc, char *argv[], int *i, int min) {
+    if (*i + 1 >= argc) fatal_error("Manca il valore di %s.", argv[*i]);
+    int v = atoi(argv[++*i]);
+    if (v < min) fatal_error("%s deve essere almeno %d.", argv[*i - 1], min);
+    return v;
+}
+
+int main(int argc, char *argv[]) {
+    int blocks = 1000, batch = 1, block_time = POW_TARGET_BLOCK_TIME, repeat = 5, samples = 1000, verbose = 0;
+    const char *mix_spec = "post=30,comment=30,vote=20,follow=10,transfer=10";
+    const char *dir = NULL;
+    char tmp_dir[] = "/tmp/wwyl_bench.XXXXXX";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--blocks") == 0) blocks = arg_int(argc, argv, &i, 1);
+        else if (strcmp(argv[i], "--users") == 0) user_count = arg_int(argc, argv, &i, 2);
+        else if (strcmp(argv[i], "--batch") == 0) batch = arg_int(argc, argv, &i, 1);
+        else if (strcmp(argv[i], "--block-time") == 0) block_time = arg_int(argc, argv, &i, 0);
+        else if (strcmp(argv[i], "--repeat") == 0) repeat = arg_int(argc, argv, &i, 1);
+        else if (strcmp(argv[i], "--samples") == 0) samples = arg_int(argc, argv, &i, 1);
+        else if (strcmp(argv[i], "--seed") == 0) rng_state = (uint32_t)arg_int(argc, argv, &i, 1);
+        else if (strcmp(argv[i], "--threads") == 0) verify_threads = arg_int(argc, argv, &i, 0);
+        else if (strcmp(argv[i], "--miner-threads") == 0) miner_threads = arg_int(argc, argv, &i, 0);
+        else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) mix_spec = argv[++i];
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "--verbose") == 0) verbose = 1;
+        else fatal_error("Opzione sconosciuta: %s", argv[i]);
+    }
+    if (user_count > BENCH_MAX_USERS) fatal_error("--users: massimo %d.", BENCH_MAX_USERS);
+    if (batch > MAX_BLOCK_ACTIONS) fatal_error("--batch: massimo %d.", MAX_BLOCK_ACTIONS);
+    if (!parse_mix(mix_spec)) fatal_error("--mix non valido: '%s' (es. post=30,comment=30,vote=20,follow=10,transfer=10).", mix_spec);
+
+    // La chain vive in una cartella a parte: i nomi dei file del ledger sono fissi
+    int own_dir = dir == NULL;
+    if (own_dir && !(dir = mkdtemp(tmp_dir))) fatal_error("Impossibile creare la cartella di lavoro.");
+    if (chdir(dir) != 0) fatal_error("Impossibile entrare in '%s'.", dir);
+    if (access(CHAIN_FILE, F_OK) == 0) fatal_error("'%s' contiene già una chain: serve una cartella vuota.", dir);
+
+    // Le righe JSON vanno sullo stdout originale; i log del nodo, se non richiesti, spariscono
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out) fatal_error("Impossibile duplicare lo stdout.");
+    if (!verbose && !freopen("/dev/null", "w", stdout)) fatal_error("Impossibile silenziare lo stdout.");
+
+    snprintf(users[0].priv, SIGNATURE_LEN, "%s", GOD_PRIV_KEY);
+    snprintf(users[0].pub, SIGNATURE_LEN, "%s", GOD_PUB_KEY);
+    for (int i = 1; i <= user_count; i++) generate_keypair(users[i].priv, users[i].pub);
+    for (int i = 0; i <= user_count; i++) {
+        if (!(users[i].session = sign_session_new(users[i].priv))) fatal_error("Chiave sintetica non valida.");
+    }
+
+    // --- 1. Mining della chain sintetica ---
+    long setup_actions = 2L * user_count;
+    long setup_blocks = (setup_actions + batch - 1) / batch;
+    long total_blocks = setup_blocks + blocks;
+    BenchOp mine;
+    op_init(&mine, "mine", total_blocks, 1);
+    posts = (int *)safe_zalloc((size_t)(total_blocks * batch + 1) * sizeof(int));
+
+    Block *tail = load_blockchain();   // Cartella vuota: crea la genesi
+    Action actions[MAX_BLOCK_ACTIONS];
+    long step = 0;
+    for (long b = 0; b < total_blocks; b++) {
+        double t0 = now();
+        int count = 0;
+        if (step < setup_actions) {
+            while (count < batch && step < setup_actions) setup_action(&actions[count++], step++);
+        } else {
+            while (count < batch) {
+                mix_action(&actions[count], actions, count);
+                count++;
+            }
+        }
+        tail = bench_mine(tail, actions, count, block_time);
+        op_add(&mine, now() - t0);
+    }
+    int height = tail->index;
+    int tip_bits = pow_block_bits(tail);
+
+    fprintf(out, "{\"bench\":\"wwyl\",\"dir\":\"%s\",\"blocks\":%d,\"users\":%d,\"batch\":%d,\"mix\":\"%s\","
+            "\"block_time\":%d,\"tip_difficulty\":%d,\"posts\":%d,\"sha256_kernel\":\"%s\",\"miner_threads\":%d,\"verify_threads\":%d}\n",
+            dir, height + 1, user_count, batch, mix_spec, block_time, tip_bits, post_count, sha256_kernel(),
+            miner_threads, verify_threads);
+    op_report(&mine);
+
+    LedgerView view;
+    if (ledger_map(CHAIN_FILE, &view) <= 0) fatal_error("Chain sintetica non leggibile.");
+    long chain_len = view.count;
+
+    // --- 2. Serializzazione del preimage (e raccolta per sha256_hash) ---
+    BenchOp serialize;
+    op_init(&serialize, "serialize_block_content", chain_len * repeat, 1);
+    char **preimages = (char **)safe_zalloc((size_t)chain_len * sizeof(char *));
+    Block *blk = (Block *)safe_zalloc(sizeof(Block));
+    for (int r = 0; r < repeat; r++) {
+        LedgerCursor cursor;
+        ledger_cursor_init(&cursor, &view);
+        for (long i = 0; ledger_cursor_next(&cursor, blk) == 1; i++) {
+            char buffer[2048];
+            double t0 = now();
+            serialize_block_content(blk, buffer, sizeof(buffer));
+            op_add(&serialize, now() - t0);
+            if (r == 0) preimages[i] = strdup(buffer);
+        }
+    }
+    op_report(&serialize);
+
+    // --- 3. sha256_hash (hex, percorso EVP) sui preimage reali ---
+    BenchOp hash;
+    op_init(&hash, "sha256_hash", chain_len * repeat, 1);
+    char hash_hex[HASH_LEN];
+    for (int r = 0; r < repeat; r++) {
+        for (long i = 0; i < chain_len; i++) {
+            double t0 = now();
+            sha256_hash(preimages[i], strlen(preimages[i]), hash_hex);
+            op_add(&hash, now() - t0);
+        }
+    }
+    op_report(&hash);
+
+    // --- 4. Firme: ecdsa_sign (chiave decodificata ogni volta) e sessione ---
+    BenchOp sign, session_sign, verify;
+    op_init(&sign, "ecdsa_sign", samples, 1);
+    op_init(&session_sign, "sign_session_sign", samples, 1);
+    op_init(&verify, "ecdsa_verify", samples, 1);
+    uint8_t (*sigs)[SIG_SIZE] = safe_zalloc((size_t)samples * SIG_SIZE);
+    char (*msgs)[HASH_LEN] = safe_zalloc((size_t)samples * HASH_LEN);
+    for (int i = 0; i < samples; i++) sha256_hash(preimages[i % chain_len], strlen(preimages[i % chain_len]), msgs[i]);
+    for (int i = 0; i < samples; i++) {
+        const BenchUser *u = &users[1 + i % user_count];
+        double t0 = now();
+        ecdsa_sign(u->priv, msgs[i], sigs[i]);
+        op_add(&sign, now() - t0);
+    }
+    for (int i = 0; i < samples; i++) {
+        uint8_t sig[SIG_SIZE];
+        double t0 = now();
+        sign_session_sign(users[1 + i % user_count].session, msgs[i], sig);
+        op_add(&session_sign, now() - t0);
+    }
+    for (int i = 0; i < samples; i++) {
+        int valid = 0;
+        double t0 = now();
+        ecdsa_verify(users[1 + i % user_count].pub, msgs[i], sigs[i], &valid);
+        op_add(&verify, now() - t0);
+        if (!valid) fatal_error("Firma sintetica #%d non valida.", i);
+    }
+    op_report(&sign);
+    op_report(&session_sign);
+    op_report(&verify);
+
+    // --- 5. verifyFullChain: completa (--paranoid) e dal checkpoint ---
+    BenchOp verify_full, verify_ckpt;
+    op_init(&verify_full, "verifyFullChain_paranoid", repeat, chain_len);
+    op_init(&verify_ckpt, "verifyFullChain_checkpoint", repeat, chain_len);
+    for (int r = 0; r < repeat; r++) {
+        verify_paranoid = 1;
+        double t0 = now();
+        if (!verifyFullChain(&view)) fatal_error("Chain sintetica rifiutata da verifyFullChain.");
+        op_add(&verify_full, now() - t0);
+
+        verify_paranoid = 0;   // La verifica appena conclusa ha salvato il checkpoint sulla coda
+        t0 = now();
+        if (!verifyFullChain(&view)) fatal_error("Chain sintetica rifiutata dal checkpoint.");
+        op_add(&verify_ckpt, now() - t0);
+    }
+    op_report(&verify_full);
+    op_report(&verify_ckpt);
+
+    // --- 6. Replay completo dello stato ---
+    // Il teardown misura il rilascio dello stato lasciato da ogni replay
+    BenchOp rebuild, teardown;
+    op_init(&rebuild, "rebuild_state_from_chain", repeat, chain_len);
+    op_init(&teardown, "state_teardown", repeat, chain_len);
+    reset_state();
+    for (int r = 0; r < repeat; r++) {
+        double t0 = now();
+        rebuild_state_from_chain(&view, 0);
+        op_add(&rebuild, now() - t0);
+        t0 = now();
+        reset_state();
+        op_add(&teardown, now() - t0);
+    }
+    op_report(&rebuild);
+    op_report(&teardown);
+    ledger_unmap(&view);
+
+    // --- 7. Avvio a freddo: map, verifica dal checkpoint, snapshot e coda ---
+    BenchOp load;
+    op_init(&load, "load_blockchain", repeat, chain_len);
+    block_free(tail);
+    for (int r = 0; r < repeat; r++) {
+        mmr_close();
+        ledger_close();
+        state_cleanup();
+        post_index_cleanup();
+        double t0 = now();
+        tail = load_blockchain();
+        op_add(&load, now() - t0);
+        block_free(tail);
+    }
+    op_report(&load);
+
+    // --- Pulizia ---
+    for (long i = 0; i < chain_len; i++) free(preimages[i]);
+    free(preimages);
+    block_free(blk);
+    free(sigs);
+    free(msgs);
+    free(posts);
+    for (int i = 0; i <= user_count; i++) sign_session_free(users[i].session);
+    mmr_close();
+    ledger_close();
+    state_cleanup();
+    post_index_cleanup();
+    crypto_cleanup();
+    if (own_dir) {
+        remove_chain_files();
+        if (chdir("/") != 0 || rmdir(dir) != 0) fprintf(stderr, "[BENCH] ⚠️ Cartella '%s' non rimossa.\n", dir);
+    }
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// --- ARENA (ALLOCAZIONE A BLOCCHI) ---
+// Allocatore "bump": gli oggetti vengono ritagliati in sequenza da blocchi
+// grandi e non si liberano uno per uno, ma tutti insieme con arena_free.
+// Adatto a strutture che nascono e muoiono insieme (lo stato dei post tra
+// un replay e il successivo). La memoria restituita è azzerata e allineata
+// a max_align_t.
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used;
+    size_t size;
+    _Alignas(max_align_t) unsigned char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk *head;         // Blocco corrente (in testa alla lista)
+    size_t chunk_size;        // 0 = ARENA_CHUNK_SIZE
+    size_t allocated;         // Byte restituiti dall'arena (statistica)
+} Arena;
+
+// Le richieste più grandi di un blocco ottengono un blocco dedicato
+void *arena_alloc(Arena *arena, size_t size);
+// Libera tutti i blocchi: l'arena torna vuota e riutilizzabile
+void arena_free(Arena *arena);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "wwyl.h"
+
+// --- HASH E FIRMA DELLE AZIONI ---
+// Preimage: "prev_hash:type:sender_pubkey:payload" (payload come nel blocco).
+// Il mittente firma l'hash in hex, come per l'header dei blocchi.
+void action_hash(const uint8_t *prev_hash, const Action *action, uint8_t *out);
+void action_sign(Action *action, const uint8_t *prev_hash, SignSession *signer);
+int action_verify(const Action *action, const uint8_t *prev_hash);
+
+// --- MERKLE ROOT ---
+// Foglie = action_hash delle azioni, nodi interni = SHA256(sx || dx); a un
+// livello dispari l'ultimo nodo viene accoppiato con sé stesso (le foglie
+// duplicate sono vietate, quindi la root non è malleabile).
+// Ritorna 0 se il batch è malformato: count fuori range, azioni annidate,
+// duplicate o più di un post (l'ID di un post è l'altezza del suo blocco).
+int batch_merkle_root(const Block *block, uint8_t *root);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef HEX_H
+#define HEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- CODIFICA ESADECIMALE ---
+// Hash, chiavi e firme passano in hex su ogni percorso caldo (preimage,
+// firme, chiavi pubbliche): niente printf/scanf per byte. La codifica usa
+// una tabella di coppie di cifre, la decodifica una tabella di valori che
+// marca i caratteri non validi; su x86 blocchi da 16 byte (32 cifre)
+// vengono convertiti e validati con SSE2.
+// Convenzioni del formato: hash in minuscolo, chiavi in maiuscolo.
+
+// 'out' deve avere spazio per 2n + 1 caratteri (terminatore incluso)
+void hex_encode(const uint8_t *in, size_t n, char *out);
+void hex_encode_upper(const uint8_t *in, size_t n, char *out);
+
+// Esattamente 2n cifre (maiuscole o minuscole), nessun terminatore richiesto.
+// Ritorna 1 se ok, 0 se c'è un carattere non esadecimale.
+int hex_decode(const char *hex, uint8_t *out, size_t n);
+
+// Stringa terminata di esattamente 2n cifre. Ritorna 1 se ok.
+int hex_parse(const char *hex, uint8_t *out, size_t n);
+
+// Case delle lettere in una stringa di len caratteri esadecimali:
+// somma di HEX_HAS_LOWER / HEX_HAS_UPPER, -1 se non è esadecimale
+#define HEX_HAS_LOWER 1
+#define HEX_HAS_UPPER 2
+int hex_case(const char *hex, size_t len);
+
+// hex_decode + hex_case in un solo passaggio: ritorna il case di 2n cifre
+// (0 se non ci sono lettere), -1 se c'è un carattere non esadecimale
+int hex_decode_case(const char *hex, uint8_t *out, size_t n);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include "wwyl.h"
+#include <stddef.h>
+
+// --- LEDGER APPEND-ONLY (wwyl_chain.dat) ---
+// Il file della chain non viene mai riscritto: ogni blocco minato viene
+// accodato e sincronizzato su disco appena supera integrity_check.
+// Un crash a metà scrittura lascia al massimo un record incompleto in coda,
+// che viene troncato al successivo avvio (torn-tail recovery).
+
+// --- FORMATO SU DISCO ---
+// v1 (legacy): dump grezzo di struct Block, padding e puntatore 'next' inclusi.
+// v2 (compact): header "WWYL" + versione, poi un record per blocco:
+//   [u32 len][u32 crc32][header blocco][u16 payload_len][payload per ActionType][u8 difficoltà]
+// Per ACT_BATCH il payload è [u16 count][merkle root] seguito dalle azioni.
+// Il byte di difficoltà manca nei record scritti prima del retarget (legacy).
+// Hash, chiavi e firme esadecimali sono salvati in binario (metà dello spazio).
+#define LEDGER_MAGIC "WWYL"
+#define LEDGER_FORMAT_NONE    0
+#define LEDGER_FORMAT_LEGACY  1
+#define LEDGER_FORMAT_COMPACT 2
+#define LEDGER_HEADER_SIZE 8
+#define LEDGER_RECORD_HEADER 8
+#define LEDGER_MAX_RECORD 32768   // Un batch pieno di MAX_BLOCK_ACTIONS azioni
+
+// Indice persistente altezza -> posizione (un u64 per blocco, dopo l'header)
+#define LEDGER_INDEX_MAGIC "WIDX"
+#define LEDGER_INDEX_HEADER 8
+
+// --- SEGMENTI ---
+// La chain è divisa in file: 'wwyl_chain.dat' (segmento 0), poi
+// 'wwyl_chain.dat.1', 'wwyl_chain.dat.2', ... Si scrive solo nell'ultimo
+// (attivo); quando arriva a LEDGER_SEGMENT_BLOCKS blocchi viene sigillato con
+// un footer [range altezze, primo/ultimo hash, CRC dei record] e non viene
+// più toccato. I segmenti sigillati si validano col solo CRC del footer.
+#ifndef LEDGER_SEGMENT_BLOCKS
+#define LEDGER_SEGMENT_BLOCKS 10000
+#endif
+#define LEDGER_FOOTER_MAGIC "WSEG"
+#define LEDGER_FOOTER_SIZE 100
+#define LEDGER_MAX_LOAD_THREADS 16
+
+// Posizione di un record: segmento nei 24 bit alti, offset nel file nei 40 bassi.
+// Nel segmento 0 coincide con l'offset, quindi i vecchi indici restano validi.
+#define LEDGER_LOC(seg, off) (((uint64_t)(seg) << 40) | (uint64_t)(off))
+#define LEDGER_LOC_SEG(loc) ((size_t)((uint64_t)(loc) >> 40))
+#define LEDGER_LOC_OFF(loc) ((size_t)((uint64_t)(loc) & ((1ULL << 40) - 1)))
+
+typedef struct {
+    int first_height;
+    int last_height;
+    uint8_t first_hash[HASH_SIZE];
+    uint8_t last_hash[HASH_SIZE];
+    uint64_t records_len;   // Byte dei record (tra header e footer)
+    uint64_t last_offset;   // Offset dell'ultimo record nel file
+    uint32_t records_crc;
+} SegmentFooter;
+
+// Codifica / Decodifica di un singolo blocco (solo il corpo del record)
+size_t ledger_encode_block(const Block *block, unsigned char *buf, size_t cap);
+int ledger_decode_block(const unsigned char *buf, size_t len, Block *out);
+
+// Formato e migrazione
+int ledger_detect_format(const char *path);
+long ledger_convert_legacy(const char *legacy_path, const char *out_path);
+int ledger_upgrade_legacy(const char *path);
+
+// --- LETTURA ZERO-ALLOC (mmap) ---
+// Il file viene mappato in sola lettura e i record vengono decodificati uno
+// alla volta in un Block di appoggio del chiamante: nessuna lista in RAM,
+// nessuna malloc per blocco. Solo l'ultimo blocco viene materializzato.
+typedef struct {
+    int fd;
+    const unsigned char *base;
+    size_t map_len;      // Lunghezza della mappatura (file originale)
+    size_t size;         // Fine dell'ultimo record valido (footer escluso)
+    long count;          // Blocchi integri nel segmento
+    size_t last_offset;  // Offset dell'ultimo record nel file
+    int sealed;
+} LedgerSegment;
+
+typedef struct {
+    LedgerSegment *segs;
+    int seg_count;
+    size_t size;         // Byte di record mappati in totale
+    long count;          // Blocchi integri nella chain
+    size_t last_offset;  // Posizione dell'ultimo record (per materializzare la coda)
+} LedgerView;
+
+typedef struct {
+    const LedgerView *view;
+    size_t offset;       // Posizione (LEDGER_LOC)
+} LedgerCursor;
+
+// Mappa tutti i segmenti e tronca un'eventuale coda corrotta del segmento
+// attivo (torn-tail recovery). 1 = ok, 0 = nessuna chain, -1 = segmento corrotto.
+int ledger_map(const char *path, LedgerView *view);
+void ledger_unmap(LedgerView *view);
+
+void ledger_cursor_init(LedgerCursor *cursor, const LedgerView *view);
+int ledger_cursor_next(LedgerCursor *cursor, Block *out);
+int ledger_read_block_at(const LedgerView *view, size_t offset, Block *out);
+int ledger_cursor_seek(LedgerCursor *cursor, int height); // Richiede il ledger aperto (indice)
+size_t *ledger_view_offsets(const LedgerView *view);
+
+// API Writer (apre anche l'indice, ricostruendolo se non combacia col ledger)
+int ledger_open(const char *path, const char *index_path);
+int ledger_append_block(const Block *block);
+void ledger_close(void);
+
+// Accesso diretto a un blocco per altezza tramite l'indice (ledger aperto)
+int get_block_by_index(int index, Block *out);
+
+#endif
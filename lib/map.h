@@ -2,23 +2,53 @@
 #define MAP_H
 
 #include <stddef.h>
+#include <stdint.h>
 
-// Nodo generico della Mappa
-typedef struct MapEntry {
-    void *key;
-    void *value;
-    struct MapEntry *next;
-} MapEntry;
+// --- HASHMAP A INDIRIZZAMENTO APERTO ---
+// Layout in stile SwissTable: per ogni slot un byte di metadati (vuoto,
+// cancellato oppure 7 bit dell'hash) e, a parte, chiave/valore/hash completo.
+// La ricerca confronta 16 byte di metadati per volta (SSE2 su x86) e chiama
+// 'compare' solo sugli slot il cui byte coincide e il cui hash è identico.
+// La capacità è una potenza di 2 (gruppi da MAP_GROUP slot, sondaggio
+// quadratico tra gruppi). L'hash dell'utente viene rimescolato: vanno bene
+// anche gli hash "identità" degli interi.
+//
+// Il resize è incrementale: la tabella piena diventa 'old' e ogni scrittura
+// successiva (put/remove) ne sposta MAP_MIGRATE_STEP slot nella nuova,
+// usando l'hash salvato (nessuna chiamata a 'hash'). Le ricerche guardano
+// prima la tabella nuova e poi quella in svuotamento.
+// I valori non si spostano mai: i puntatori restituiti da map_get restano
+// validi finché la chiave non viene sovrascritta o rimossa.
+#define MAP_GROUP 16
+#define MAP_MIGRATE_STEP 64
+#define MAP_MAX_LOAD_NUM 7      // Slot occupati (anche cancellati) fino a 7/8
+#define MAP_MAX_LOAD_DEN 8
 
 // Tipi di funzione per la personalizzazione
 typedef unsigned long (*HashFunc)(const void *key);
 typedef int (*CompareFunc)(const void *key1, const void *key2);
 typedef void (*FreeFunc)(void *data); // <--- Callback per liberare la memoria
+typedef void (*MapIterFunc)(void *key, void *value, void *ctx); // Visita di ogni entry
+
+// Slot della tabella
+typedef struct {
+    void *key;
+    void *value;
+    uint64_t hash;       // Hash rimescolato, salvato per resize e confronti rapidi
+} MapSlot;
+
+typedef struct {
+    uint8_t *ctrl;       // Metadati: MAP_CTRL_EMPTY, MAP_CTRL_DELETED o 7 bit di hash
+    MapSlot *slots;
+    size_t capacity;     // 0 = tabella assente
+    size_t used;         // Slot pieni + cancellati (determinano il carico)
+} MapTable;
 
 // Struttura Hashmap
 typedef struct {
-    MapEntry **buckets;
-    int size;
+    MapTable table;      // Tabella attiva: i nuovi inserimenti vanno qui
+    MapTable old;        // Tabella in svuotamento durante un resize
+    size_t migrate_pos;  // Prossimo slot di 'old' da spostare
     int count;
     HashFunc hash;
     CompareFunc compare;
@@ -30,6 +60,10 @@ typedef struct {
 HashMap *map_create(int initial_size, HashFunc hash, CompareFunc compare, FreeFunc free_key, FreeFunc free_val);
 void map_put(HashMap *map, void *key, void *value);
 void *map_get(HashMap *map, const void *key);
+// Rimuove la chiave liberandone chiave e valore: 1 se c'era, 0 altrimenti
+int map_remove(HashMap *map, const void *key);
+// La callback non deve inserire né rimuovere chiavi
+void map_foreach(HashMap *map, MapIterFunc fn, void *ctx);
 void map_destroy(HashMap *map);
 
 // Helpers pronti all'uso
@@ -39,4 +73,4 @@ int cmp_str(const void *k1, const void *k2);
 unsigned long hash_int_direct(const void *key);
 int cmp_int_direct(const void *k1, const void *k2);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,48 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include "wwyl.h"
+
+// --- MEMPOOL E MINER IN BACKGROUND ---
+// Le azioni validate dalla CLI entrano nel mempool e ricevono un ticket; un
+// thread dedicato le preleva in ordine di arrivo e le mina: un blocco a
+// singola azione se ce n'è una sola, altrimenti un batch (vedi batch.h).
+// Stato in RAM (utenti, post, relazioni), ledger e coda della chain sono
+// condivisi col miner: chi li tocca deve tenere chain_lock(). La PoW gira
+// senza lock, la CLI resta libera durante il mining.
+#define MEMPOOL_CAPACITY 1024
+#define MEMPOOL_TICKET_HISTORY 1024   // Esiti ricordati per mempool_ticket()
+
+typedef enum {
+    TICKET_UNKNOWN = 0,   // Mai emesso, oppure troppo vecchio
+    TICKET_PENDING,
+    TICKET_INCLUDED,
+    TICKET_DROPPED        // Mining fallito: l'azione non è sulla chain
+} TicketStatus;
+
+void chain_lock(void);
+void chain_unlock(void);
+
+void mempool_start(Block *tip);
+void mempool_stop(void);          // Mina ciò che resta in coda e ferma il thread
+Block *mempool_tip(void);         // Ultimo blocco della chain (sotto chain_lock)
+
+// Ritorna il ticket (> 0), oppure -1 se il mempool è pieno. Va chiamata sotto
+// chain_lock: 'debit' sono i token che l'azione spenderà all'inclusione.
+// La sessione di firma resta del chiamante e deve vivere fino a mempool_stop()
+long mempool_submit(ActionType type, const void *payload, const char *pubkey_hex, SignSession *signer, int debit);
+TicketStatus mempool_ticket(long ticket, int *block_index);
+TicketStatus mempool_wait(long ticket, int *block_index);
+
+// Impegni delle azioni accodate o in mining, non ancora applicati allo stato.
+// La CLI valida le nuove azioni contro saldo - addebiti in sospeso: due azioni
+// in coda non possono spendere gli stessi token. Sotto chain_lock.
+int mempool_pending_debit(const char *pubkey_hex);
+int mempool_registration_pending(const char *pubkey_hex);
+int mempool_finalize_pending(int post_id);
+
+int mempool_pending(void);        // In coda + in mining
+void mempool_flush(void);         // Attende che tutto il mempool sia minato
+void mempool_print_notifications(void);
+
+#endif
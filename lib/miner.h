@@ -0,0 +1,25 @@
+#ifndef MINER_H
+#define MINER_H
+
+#include "wwyl.h"
+#include <stddef.h>
+
+// --- MINER PARALLELO ---
+// Lo spazio dei nonce viene diviso tra gli N thread partiti (il thread t prova t, t+N,
+// t+2N, ...). Tutti partono dallo stesso midstate SHA256 del prefisso e si
+// fermano appena uno trova un hash valido. Il nonce vincente è quello
+// trovato per primo, non necessariamente il più piccolo: per la verifica
+// qualsiasi nonce valido va bene. Ogni thread prova SHA256_MAX_LANES nonce
+// per volta con sha256_many (corsie SIMD o SHA-NI, vedi sha256.h).
+#define MINER_MAX_THREADS 64
+#define MINER_STOP_CHECK 256   // Tentativi tra un controllo e l'altro del flag di stop (multiplo di SHA256_MAX_LANES)
+
+extern int miner_threads;      // --miner-threads N (0 = un thread per core)
+
+// Cerca un nonce per il preimage "prefix<nonce>suffix" con almeno 'bits' bit
+// zero iniziali. Ritorna 1 e riempie nonce/hash se trovato, 0 se lo spazio
+// dei nonce è esaurito.
+int miner_search(const char *prefix, size_t prefix_len, const char *suffix, size_t suffix_len,
+                 int bits, int *nonce_out, uint8_t *hash_out);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MMR_H
+#define MMR_H
+
+#include "wwyl.h"
+#include "ledger.h"
+
+// --- MERKLE MOUNTAIN RANGE (wwyl_chain.mmr) ---
+// Accumulatore append-only sugli hash dei blocchi: la foglia h è il
+// curr_hash del blocco h, un nodo interno è SHA256(sx || dx) come nei batch.
+// I nodi sono salvati in post-ordine (header "WMMR" + versione, poi 32 byte
+// per nodo): ogni blocco aggiunge la sua foglia e i genitori che completa.
+// La root "insacca" i picchi da destra a sinistra: SHA256(picco_i || bag).
+// Con root e prova (fratelli fino al picco + picchi) si dimostra che un
+// blocco sta nella chain in O(log n), senza rileggere il ledger.
+// È un dato derivato come l'indice: se non combacia col ledger si ricostruisce.
+#define MMR_MAGIC "WMMR"
+#define MMR_VERSION 1
+#define MMR_HEADER_SIZE 8
+#define MMR_MAX_HEIGHT 48     // Fino a 2^48 blocchi
+
+typedef struct {
+    long leaf_index;          // Altezza del blocco
+    long leaf_count;          // Blocchi coperti dalla root
+    int path_len;
+    uint8_t path[MMR_MAX_HEIGHT][HASH_SIZE];    // Fratelli, dalla foglia al picco
+    int peak_count;
+    uint8_t peaks[MMR_MAX_HEIGHT][HASH_SIZE];   // Picchi da sinistra a destra
+} MmrProof;
+
+// Apre l'accumulatore e lo ricostruisce dal ledger se non combacia con 'view'
+// (NULL = chain nuova, accumulatore vuoto).
+int mmr_open(const char *path, const LedgerView *view);
+int mmr_append(const uint8_t *block_hash);
+void mmr_close(void);
+
+long mmr_leaf_count(void);
+int mmr_root(uint8_t *root);
+int mmr_prove(long leaf_index, MmrProof *proof);
+
+// Verifica senza accumulatore (basta la root): 1 se 'block_hash' è la foglia
+// proof->leaf_index della chain con quella root.
+int mmr_verify(const uint8_t *block_hash, const MmrProof *proof, const uint8_t *root);
+
+#endif
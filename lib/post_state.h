@@ -3,6 +3,7 @@
 
 #include "wwyl.h"
 #include "map.h"
+#include "arena.h"
 
 // Struttura Nodo Hashmap Post
 typedef struct PostStateNode {
@@ -21,16 +22,18 @@ extern HashMap *global_post_index;
 
 // API Indice
 void post_index_init();
-void post_index_add(int post_id, const char *author);
+// Memoria azzerata per PostState e nodi: resta valida fino a post_index_cleanup
+void *post_state_alloc(size_t size);
+void post_index_add(int post_id, UserId author);
 void post_index_cleanup();
 PostState *post_index_get(int post_id);
 int post_index_exists(int post_id);
-char *post_index_author(int post_id);
+UserId post_index_author(int post_id);
 
-// API Voti
-void post_register_commit(int post_id, const char *voter, const char *hash);
-int post_verify_commit(int post_id, const char *voter, const char *calculated_hash);
-void post_register_reveal(int post_id, const char *voter, int vote_val); 
-void post_register_comment(int post_id, const char *author, const char *content, time_t timestamp);
+// API Voti (autori e votanti come ID internati, vedi state_intern)
+void post_register_commit(int post_id, UserId voter, const uint8_t *hash);
+int post_verify_commit(int post_id, UserId voter, const uint8_t *calculated_hash);
+void post_register_reveal(int post_id, UserId voter, int vote_val); 
+void post_register_comment(int post_id, UserId author, const char *content, time_t timestamp);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- SHA256 CON STATO COPIABILE (midstate) ---
+// Implementazione scalare per il mining: il contesto è una struct piatta,
+// quindi dopo aver assorbito il prefisso costante del preimage basta una
+// copia per struct (nessuna malloc, nessun EVP_MD_CTX) per ogni nonce.
+// Le firme e gli hash isolati continuano a usare OpenSSL (sha256_hash / sha256_raw).
+typedef struct {
+    uint32_t state[8];
+    uint64_t total_len;    // Byte assorbiti finora
+    uint8_t buffer[64];    // Blocco parziale in attesa
+    size_t buffer_len;
+} Sha256Ctx;
+
+void sha256_init(Sha256Ctx *ctx);
+void sha256_update(Sha256Ctx *ctx, const void *data, size_t len);
+void sha256_final(Sha256Ctx *ctx, uint8_t *digest);
+
+// --- SHA256 MULTI-BUFFER ---
+// Hash di n messaggi indipendenti, ciascuno in coda a 'start' (NULL = da
+// zero). Il kernel viene scelto a runtime in base alla CPU: SHA-NI, AVX2
+// (8 messaggi per volta), SSE2 (4) o scalare. Conviene con messaggi di
+// lunghezza uguale o simile, come i nonce del mining o i blocchi di un chunk.
+#define SHA256_MAX_LANES 8
+
+void sha256_many(const Sha256Ctx *start, const uint8_t *const msgs[], const size_t lens[], int n,
+                 uint8_t digests[][32]);
+const char *sha256_kernel(void);          // Nome del kernel attivo
+int sha256_set_kernel(const char *name);  // Forza un kernel: 0 se la CPU non lo supporta
+
+#endif
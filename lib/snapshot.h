@@ -0,0 +1,23 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "wwyl.h"
+
+// --- SNAPSHOT DELLO STATO (wwyl_state.snap) ---
+// Fotografia binaria di world_state, global_post_index, relation_map e
+// global_tokens_circulating, etichettata con altezza e hash dell'ultimo
+// blocco applicato. All'avvio si ripristina lo snapshot valido più recente
+// e si riesegue solo la coda della chain.
+// Viene scritto solo durante il replay, quando lo stato deriva al 100% dai
+// blocchi (le modifiche solo-RAM della sessione non devono sopravvivere).
+#define SNAPSHOT_MAGIC "WSNP"
+#define SNAPSHOT_VERSION 3     // 3: chiavi internate, stato per UserId
+#ifndef SNAPSHOT_INTERVAL
+#define SNAPSHOT_INTERVAL 1000 // Blocchi tra uno snapshot e il successivo
+#endif
+
+// Ritorna l'altezza ripristinata, oppure -1 (stato vuoto, replay completo)
+int snapshot_load(const char *path);
+int snapshot_save(const char *path, int height, const uint8_t *block_hash);
+
+#endif
@@ -7,6 +7,7 @@
 #include "utils.h"
 #include "wwyl_crypto.h"
 #include "map.h"
+#include "ledger.h"
 #include <unistd.h>
 
 #define COSTO_TOKEN_BASE 1 
@@ -21,45 +22,96 @@ extern long long global_tokens_circulating; // <--- AGGIUNTO: Serve al main per
 #define REL_MAP_SIZE 2048
 
 // --- STRUTTURE STATE MANAGEMENT ---
-typedef struct StateNode {
-    char wallet_address[SIGNATURE_LEN];
-    UserState state;
-    struct StateNode *next;
-} StateNode;
+// world_state è anche la tabella di interning delle chiavi pubbliche: ogni
+// chiave che compare nello stato (utenti, autori, votanti, relazioni) riceve
+// alla prima apparizione un UserId denso, l'indice della sua voce. Post, voti,
+// commenti e relazioni conservano solo l'ID; la stringa esiste una volta sola,
+// in wallet_address. Una voce è un utente solo dopo la registrazione.
+// L'indice è la chiave decodificata (65 byte, o 33 se compressa): l'hash usa
+// un prefisso fisso della coordinata x (già casuale) e il confronto è un memcmp.
+// La forma testuale resta la chiave di consenso: le lettere della stringa
+// (maiuscole/minuscole) fanno parte della chiave, quindi due grafie della
+// stessa chiave restano due voci distinte come con le stringhe. Le stringhe
+// che non sono chiavi pubbliche (es. un target inesistente) vengono internate
+// per testo.
+#define USER_KEY_MAX 65
+#define USER_KEY_COMPRESSED 33
+#define USER_CHUNK 64           // Voci per blocco: gli indirizzi restano stabili
 
 typedef struct {
-    StateNode **buckets; 
-    int size; 
-    int count;
-} StateMap;
+    uint8_t bytes[USER_KEY_MAX];
+    uint8_t len;                // USER_KEY_MAX, USER_KEY_COMPRESSED o 0 (testo)
+    uint8_t letters;            // HEX_HAS_LOWER / HEX_HAS_UPPER della forma testuale
+} UserKey;
 
+typedef struct {
+    UserKey key;
+    uint8_t registered;         // 0 = chiave solo internata, non è un utente
+    UserId id;
+    UserState state;            // wallet_address sempre valorizzato
+} UserEntry;
+
+typedef struct {
+    uint64_t prefix;            // Primi 8 byte della coordinata x (o hash del testo)
+    UserEntry *entry;           // NULL = slot vuoto
+} UserSlot;
+
+typedef struct {
+    UserSlot *slots;            // Indirizzamento aperto, sondaggio lineare
+    size_t capacity;            // Potenza di 2, carico massimo 1/2
+    UserEntry **chunks;         // Voci in ordine di ID, USER_CHUNK per blocco
+    size_t chunk_cap;
+    int count;                  // Voci internate (registrate e non)
+} UserTable;
+
+// Relazione follower -> target, per ID
 typedef struct RelationNode {
-    char key[SIGNATURE_LEN * 2]; 
+    UserId follower;
+    UserId target;
     struct RelationNode *next;
 } RelationNode;
 
-extern HashMap *world_state;
+extern UserTable *world_state;
+extern RelationNode *relation_map[REL_MAP_SIZE];
 
 // --- API STATE ---
 void state_init();
 UserState *state_get_user(const char *wallet_address);
+// Record dell'utente, creato vuoto se manca (*created = 1): le modifiche si
+// fanno direttamente sul puntatore. NULL se l'indirizzo è troppo lungo.
+UserState *state_get_or_create(const char *wallet_address, int *created);
 void state_update_user(const char *wallet_address, const UserState *new_state);
+
+// --- INTERNING DELLE CHIAVI ---
+// ID della chiave, assegnato se manca. USER_ID_NONE se la stringa non entra
+// in wallet_address (nessuna firma o payload valido la contiene).
+UserId state_intern(const char *pubkey);
+// Solo ricerca: USER_ID_NONE se la chiave non è mai comparsa
+UserId state_user_id(const char *pubkey);
+const char *state_user_pubkey(UserId id);
+// Stato dell'utente con quell'ID, NULL se non è registrato
+UserState *state_user_by_id(UserId id);
 void state_add_new_user(const char *wallet_address, const char *username, const char *bio, const char *pic);
-void rebuild_state_from_chain(Block *genesis);
+void state_apply_block(const Block *block);
+void rebuild_state_from_chain(const LedgerView *view, int from_height);
 void state_cleanup();
 int state_check_follow_status(const char *follower, const char *target);
 void state_toggle_follow(const char *follower, const char *target);
 
 // --- FUNZIONI UTENTE (MINING) ---
-Block *register_user(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
-int user_login(const char *privkey_hex, const char *pubkey_hex);
-Block *user_follow(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
-Block *user_post(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
-Block *user_comment(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
-Block *user_like(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
-Block *user_reveal(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
-Block *user_finalize(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
-Block *user_transfer(Block *prev_block, const void *payload, const char *privkey_hex, const char *pubkey_hex);
+// Validano l'azione sullo stato attuale e la accodano nel mempool: ritornano
+// il ticket (> 0) oppure -1 se l'azione è stata rifiutata. Gli effetti sullo
+// stato arrivano con state_apply_block quando il blocco viene minato.
+// Vanno chiamate con chain_lock() preso.
+long register_user(const void *payload, SignSession *signer, const char *pubkey_hex);
+int user_login(SignSession *signer, const char *pubkey_hex);
+long user_follow(const void *payload, SignSession *signer, const char *pubkey_hex);
+long user_post(const void *payload, SignSession *signer, const char *pubkey_hex);
+long user_comment(const void *payload, SignSession *signer, const char *pubkey_hex);
+long user_like(const void *payload, SignSession *signer, const char *pubkey_hex);
+long user_reveal(const void *payload, SignSession *signer, const char *pubkey_hex);
+long user_finalize(const void *payload, SignSession *signer, const char *pubkey_hex);
+long user_transfer(const void *payload, SignSession *signer, const char *pubkey_hex);
 
 // --- NUOVE FUNZIONI ECONOMIA (AGGIUNTE) ---
 float get_economy_multiplier(); // <--- FIX: Ora wwyl.c la vede
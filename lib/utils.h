@@ -10,10 +10,20 @@
 #include <stdio.h>
 #include <openssl/rand.h> 
 #include <limits.h>
+#include <stdint.h>
 
 void fatal_error(const char *fmt, ...);
 void *safe_zalloc(size_t size);
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len);
 void errExit(const char *msg);
 char *getRandomWord(void);
 
+// Output informativo dei percorsi condivisi col miner in background: sul
+// thread che ha chiamato node_printf_defer le righe vengono accumulate e
+// stampate da node_printf_flush (con le notifiche del mempool), così non
+// finiscono sopra il prompt della CLI. Altrove è un printf.
+void node_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void node_printf_defer(void);
+void node_printf_flush(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "wwyl.h"
+#include "ledger.h"
+
+// --- VERIFICA DELLA CHAIN ---
+// Hash e firme di ogni blocco dipendono solo dal blocco stesso: il ledger
+// mappato viene diviso in chunk di altezze che un pool di thread si contende.
+// Ogni worker controlla anche il link prev_hash dei propri blocchi (decodifica
+// un blocco in più all'inizio del chunk). L'errore riportato è sempre quello
+// con l'altezza più bassa, come nella verifica sequenziale.
+#define VERIFY_CHUNK_SIZE 64
+#define VERIFY_MAX_THREADS 64
+
+extern int verify_paranoid; // --paranoid: ignora il checkpoint
+extern int verify_threads;  // --threads N (0 = un thread per core)
+
+int verifyFullChain(const LedgerView *view);
+
+// Checkpoint (wwyl_chain.ckpt): "altezza hash" in formato testo
+int checkpoint_load(const char *path, ChainCheckpoint *cp);
+void checkpoint_save(const char *path, int height, const uint8_t *hash);
+
+#endif
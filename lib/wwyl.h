@@ -3,14 +3,41 @@
 
 #include <stdint.h>
 #include <time.h>
+#include "wwyl_crypto.h"
 
 // --- COSTANTI DI SICUREZZA ---
 #define HASH_LEN 65         
 #define SIGNATURE_LEN 132   
+#define HASH_SIZE 32        // SHA256 binario (HASH_LEN = forma hex + terminatore)
+#define SIG_SIZE 64         // Firma ECDSA binaria: r || s, 32 byte ciascuno
 #define MAX_CONTENT_LEN 256 
 #define MAX_NAME_LEN 32
 #define INITIAL_POST_MAP_SIZE 128
 
+// --- PROOF-OF-WORK ---
+// La difficoltà è il numero di bit zero iniziali richiesti all'hash ed è
+// registrata in ogni blocco. Ogni POW_RETARGET_INTERVAL blocchi viene
+// ricalcolata sul tempo impiegato dall'ultima finestra: +1 bit se i blocchi
+// sono arrivati in meno della metà del tempo atteso, -1 bit se in più del
+// doppio. I parametri fanno parte del consenso: vanno fissati a compile time.
+#ifndef POW_TARGET_BLOCK_TIME
+#define POW_TARGET_BLOCK_TIME 10    // Secondi attesi tra due blocchi
+#endif
+#ifndef POW_RETARGET_INTERVAL
+#define POW_RETARGET_INTERVAL 16
+#endif
+#define POW_INITIAL_BITS 8          // Come il vecchio "00": primo byte nullo
+#define POW_LEGACY_BITS 8           // Blocchi senza difficoltà registrata
+#define POW_MIN_BITS 1
+#define POW_MAX_BITS 28             // Oltre, 2^31 nonce non bastano
+
+// I timestamp guidano il retarget: miner e verifica rifiutano un blocco più
+// vecchio del padre o più avanti di così rispetto all'orologio locale.
+// Il bench genera chain sintetiche nel futuro e lo compila più largo.
+#ifndef POW_MAX_FUTURE_DRIFT
+#define POW_MAX_FUTURE_DRIFT 7200   // Secondi
+#endif
+
 // --- ECONOMIA ---
 #define COSTO_VOTO 2
 #define COSTO_POST 4
@@ -18,6 +45,11 @@
 #define MAX_CAPACITY_LOAD 0.75
 
 #define WALLET_FILE "wwyl.wallet"
+#define CHAIN_FILE "wwyl_chain.dat"
+#define CHAIN_INDEX_FILE "wwyl_chain.idx"
+#define CHAIN_MMR_FILE "wwyl_chain.mmr"
+#define STATE_SNAPSHOT_FILE "wwyl_state.snap"
+#define CHECKPOINT_FILE "wwyl_chain.ckpt"
 
 // --- TIPI DI AZIONE ---
 typedef enum {
@@ -28,9 +60,16 @@ typedef enum {
     ACT_VOTE_REVEAL = 4,   
     ACT_FOLLOW_USER = 5,
     ACT_POST_FINALIZE = 6,
-    ACT_TRANSFER = 7
+    ACT_TRANSFER = 7,
+    ACT_BATCH = 8           // Più azioni firmate singolarmente sotto una Merkle root
 } ActionType;
 
+// --- BATCH DI AZIONI ---
+// Un blocco ACT_BATCH paga PoW e header una volta sola per fino a
+// MAX_BLOCK_ACTIONS azioni. Il preimage del blocco contiene solo la Merkle
+// root; ogni azione mantiene la firma del proprio mittente.
+#define MAX_BLOCK_ACTIONS 64
+
 // --- STRUTTURE PAYLOAD (Dati su Disco) ---
 typedef struct {
     char username[32]; 
@@ -53,7 +92,7 @@ typedef struct {
 
 typedef struct {
     int target_post_id;       
-    char vote_hash[HASH_LEN]; 
+    uint8_t vote_hash[HASH_SIZE]; 
 } PayloadCommit;
 
 typedef struct {
@@ -71,31 +110,64 @@ typedef struct {
     char target_user_pubkey[SIGNATURE_LEN]; 
 } PayloadFollow;
 
+typedef struct {
+    int count;                       // Azioni nel blocco (1..MAX_BLOCK_ACTIONS)
+    uint8_t merkle_root[HASH_SIZE];
+} PayloadBatch;
+
+typedef union {
+    PayloadPost post;
+    PayloadCommit commit;
+    PayloadReveal reveal;
+    PayloadComment comment;
+    PayloadFollow follow;
+    PayloadRegister registration;
+    PayloadFinalize finalize;
+    PayloadTransfer transfer;
+    PayloadBatch batch;
+} ActionPayload;
+
+// --- AZIONE DENTRO UN BATCH ---
+// La firma copre "prev_hash:type:sender:payload" (vedi action_hash): un'azione
+// vale solo nel blocco che segue quello su cui è stata firmata.
+typedef struct {
+    ActionType type;
+    char sender_pubkey[SIGNATURE_LEN];
+    uint8_t signature[SIG_SIZE];
+    ActionPayload data;
+} Action;
+
 // --- STRUTTURA BLOCCO ---
+// Hash e firma sono binari: l'esadecimale esiste solo a video e nel preimage
+// di hashing/firma (hex minuscolo, come nel formato originale).
 typedef struct Block {
     int index;                
     time_t timestamp;
-    char prev_hash[HASH_LEN]; 
-    char curr_hash[HASH_LEN]; 
+    uint8_t prev_hash[HASH_SIZE]; 
+    uint8_t curr_hash[HASH_SIZE]; 
     ActionType type;
     char sender_pubkey[SIGNATURE_LEN]; 
-    char signature[SIGNATURE_LEN]; 
+    uint8_t signature[SIG_SIZE]; 
     int nonce;
+    uint8_t difficulty;       // Bit zero iniziali (0 = blocco legacy, POW_LEGACY_BITS)
     
-    union {
-        PayloadPost post;
-        PayloadCommit commit;
-        PayloadReveal reveal;
-        PayloadComment comment;
-        PayloadFollow follow;
-        PayloadRegister registration;
-        PayloadFinalize finalize;
-        PayloadTransfer transfer;
-    } data;
+    ActionPayload data;
 
     struct Block *next; 
+
+    // Solo per ACT_BATCH: data.batch.count azioni, allocate fuori dal Block
+    // così un blocco singolo non si porta dietro MAX_BLOCK_ACTIONS slot vuoti.
+    // Un Block decodificato più volte riusa l'array; si libera con block_release.
+    Action *actions;
 } Block;
 
+// --- CHECKPOINT DI VERIFICA ---
+// Sotto questa altezza il boot salta firme ECDSA e PoW (solo hash-link)
+typedef struct {
+    int height;
+    uint8_t hash[HASH_SIZE];
+} ChainCheckpoint;
+
 // --- STRUTTURA STATO UTENTE (RAM) ---
 typedef struct {
     char wallet_address[SIGNATURE_LEN];
@@ -123,24 +195,31 @@ typedef struct {
     int count;
 } WalletStore;
 
+// --- ID UTENTE ---
+// Le chiavi pubbliche vengono internate una volta sola nella tabella utenti
+// (vedi user.h): lo stato di post, voti, commenti e relazioni conserva solo
+// l'ID denso assegnato alla prima apparizione della chiave.
+typedef uint32_t UserId;
+#define USER_ID_NONE UINT32_MAX
+
 // --- STRUTTURE POST STATE (RAM) ---
 
 // Nodo per i voti segreti (Commit)
 typedef struct CommitNode {
-    char voter_pubkey[SIGNATURE_LEN];
-    char vote_hash[HASH_LEN];
+    UserId voter_id;
+    uint8_t vote_hash[HASH_SIZE];
     struct CommitNode *next;
 } CommitNode;
 
 // Nodo per i voti svelati (Reveal)
 typedef struct RevealNode {
-    char voter_pubkey[SIGNATURE_LEN];
+    UserId voter_id;
     int vote_value;
     struct RevealNode *next;
 } RevealNode;
 
 typedef struct CommentNode {
-    char author_pubkey[SIGNATURE_LEN];
+    UserId author_id;
     char content[MAX_CONTENT_LEN];
     time_t timestamp;
     struct CommentNode *next;
@@ -149,7 +228,7 @@ typedef struct CommentNode {
 // Stato Mutabile del Post
 typedef struct {
     int post_id;
-    char author_pubkey[SIGNATURE_LEN];
+    UserId author_id;
     
     int likes;
     int dislikes;
@@ -167,10 +246,21 @@ typedef struct {
 // --- PROTOTIPI GLOBALI ---
 Block* initialize_blockchain(void);
 void print_block(const Block *block);
-Block *mine_new_block(Block *prev_block, ActionType type, const void *payload_data, const char *sender_pubkey, const char *sender_privkey);
-int integrity_check(Block *prev, Block *curr); 
+Block *block_new_action(const Block *prev_block, ActionType type, const void *payload_data, const char *sender_pubkey);
+Block *block_new_batch(const Block *prev_block, const Action *actions, int count, const char *miner_pubkey);
+int block_prepare(const Block *prev_block, Block *new_block);
+int block_solve(Block *new_block, SignSession *signer);
+int block_commit(Block *prev_block, Block *new_block);
+void block_release(Block *block);   // Libera le azioni, il Block resta riusabile
+void block_free(Block *block);      // block_release + free di un Block allocato
+int integrity_check(const Block *prev, const Block *curr); 
 void serialize_block_content(const Block *block, char *buffer, size_t size);
-void save_blockchain(Block *genesis);
+void serialize_action_payload(ActionType type, const ActionPayload *data, char *payload_str, size_t payload_size);
+void action_set_payload(ActionPayload *dst, ActionType type, const void *payload_data);
+int pow_block_bits(const Block *block);
+int pow_next_difficulty(const Block *prev, const Block *window_start);
+int pow_hash_meets(const uint8_t *hash, int bits);
+void save_blockchain(const Block *tail);
 Block *load_blockchain();
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef WWYL_CRYPTO_H
 #define WWYL_CRYPTO_H
 
+#include <stdint.h>
 #include <openssl/evp.h>
 #include <openssl/core_names.h>
 #include <openssl/param_build.h>
@@ -9,10 +10,31 @@
 #include <openssl/pem.h>  
 
 #define SHA256_DIGEST_LENGTH 32
+#define PRIV_KEY_SIZE 32         // Scalare secp256k1
+
+// Cache LRU delle chiavi pubbliche già decodificate (usata da ecdsa_verify)
+#ifndef PKEY_CACHE_SIZE
+#define PKEY_CACHE_SIZE 512
+#endif
+#define PKEY_CACHE_BUCKETS (PKEY_CACHE_SIZE * 2)
 
 void sha256_hash(const char *input, size_t len, char *output_hex);
+void sha256_raw(const void *input, size_t len, uint8_t *output);
 void generate_keypair(char *priv_hex_out, char *pub_hex_out);
-void ecdsa_sign(const char *private_key_hex, const char *message, char *signature_hex);
-void ecdsa_verify(const char *public_key_hex, const char *message, const char *signature_hex, int *is_valid);
+// Firma binaria a 64 byte: r e s big-endian, 32 byte ciascuno
+void ecdsa_sign(const char *private_key_hex, const char *message, uint8_t *signature);
+void ecdsa_verify(const char *public_key_hex, const char *message, const uint8_t *signature, int *is_valid);
+void pkey_cache_clear(void);
+void crypto_cleanup(void);
+
+// --- SESSIONE DI FIRMA ---
+// Chiave privata già decodificata e contesto di firma riusabile: si apre al
+// login di un'identità e si usa per tutte le sue firme (blocchi, azioni,
+// challenge). Thread-safe. NULL se la chiave non è valida.
+typedef struct SignSession SignSession;
+
+SignSession *sign_session_new(const char *private_key_hex);
+void sign_session_free(SignSession *session);
+void sign_session_sign(SignSession *session, const char *message, uint8_t *signature);
 
 #endif
\ No newline at end of file
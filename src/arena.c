@@ -0,0 +1,57 @@
+#include "arena.h"
+#include "utils.h"
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+static ArenaChunk *chunk_new(size_t size) {
+    // safe_zalloc azzera: finché un blocco vive, i suoi byte vengono dati una volta sola
+    ArenaChunk *c = safe_zalloc(sizeof(ArenaChunk) + size);
+    c->size = size;
+    return c;
+}
+
+// ---------------------------------------------------------
+// ALLOCAZIONE
+// ---------------------------------------------------------
+void *arena_alloc(Arena *arena, size_t size) {
+    size_t chunk_size = arena->chunk_size ? arena->chunk_size : ARENA_CHUNK_SIZE;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk *c = arena->head;
+    if (!c || c->size - c->used < size) {
+        if (size > chunk_size) {
+            // Blocco dedicato subito dietro la testa: quello corrente resta in uso
+            ArenaChunk *big = chunk_new(size);
+            big->used = size;
+            if (c) {
+                big->next = c->next;
+                c->next = big;
+            } else {
+                arena->head = big;
+            }
+            arena->allocated += size;
+            return big->data;
+        }
+        c = chunk_new(chunk_size);
+        c->next = arena->head;
+        arena->head = c;
+    }
+    void *p = c->data + c->used;
+    c->used += size;
+    arena->allocated += size;
+    return p;
+}
+
+// ---------------------------------------------------------
+// RILASCIO IN BLOCCO
+// ---------------------------------------------------------
+void arena_free(Arena *arena) {
+    ArenaChunk *c = arena->head;
+    while (c) {
+        ArenaChunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    arena->head = NULL;
+    arena->allocated = 0;
+}
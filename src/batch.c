@@ -0,0 +1,69 @@
+#include "utils.h"
+#include "batch.h"
+#include "wwyl_crypto.h"
+#include "hex.h"
+
+// ---------------------------------------------------------
+// HASH E FIRMA DELLE AZIONI
+// ---------------------------------------------------------
+void action_hash(const uint8_t *prev_hash, const Action *action, uint8_t *out) {
+    char payload_str[MAX_CONTENT_LEN + 20];
+    char prev_hex[HASH_LEN];
+    char buffer[1024];
+
+    serialize_action_payload(action->type, &action->data, payload_str, sizeof(payload_str));
+    hex_encode(prev_hash, HASH_SIZE, prev_hex);
+    int len = snprintf(buffer, sizeof(buffer), "%s:%d:%s:%s", prev_hex, action->type, action->sender_pubkey, payload_str);
+    sha256_raw(buffer, (len > 0 && (size_t)len < sizeof(buffer)) ? (size_t)len : strlen(buffer), out);
+}
+
+void action_sign(Action *action, const uint8_t *prev_hash, SignSession *signer) {
+    uint8_t hash[HASH_SIZE];
+    char hash_hex[HASH_LEN];
+    action_hash(prev_hash, action, hash);
+    hex_encode(hash, HASH_SIZE, hash_hex);
+    sign_session_sign(signer, hash_hex, action->signature);
+}
+
+int action_verify(const Action *action, const uint8_t *prev_hash) {
+    uint8_t hash[HASH_SIZE];
+    char hash_hex[HASH_LEN];
+    int is_valid = 0;
+    action_hash(prev_hash, action, hash);
+    hex_encode(hash, HASH_SIZE, hash_hex);
+    ecdsa_verify(action->sender_pubkey, hash_hex, action->signature, &is_valid);
+    return is_valid;
+}
+
+// ---------------------------------------------------------
+// MERKLE ROOT
+// ---------------------------------------------------------
+int batch_merkle_root(const Block *block, uint8_t *root) {
+    int count = block->data.batch.count;
+    if (block->type != ACT_BATCH || count < 1 || count > MAX_BLOCK_ACTIONS) return 0;
+
+    uint8_t level[MAX_BLOCK_ACTIONS][HASH_SIZE];
+    int posts = 0;
+    for (int i = 0; i < count; i++) {
+        const Action *a = &block->actions[i];
+        if (a->type < ACT_REGISTER_USER || a->type >= ACT_BATCH) return 0;
+        if (a->type == ACT_POST_CONTENT && ++posts > 1) return 0;
+
+        action_hash(block->prev_hash, a, level[i]);
+        for (int j = 0; j < i; j++) {
+            if (memcmp(level[j], level[i], HASH_SIZE) == 0) return 0;
+        }
+    }
+
+    // Riduzione sul posto: il nodo i del livello successivo sovrascrive level[i]
+    uint8_t pair[2 * HASH_SIZE];
+    for (int n = count; n > 1; n = (n + 1) / 2) {
+        for (int i = 0; i < n; i += 2) {
+            memcpy(pair, level[i], HASH_SIZE);
+            memcpy(pair + HASH_SIZE, level[(i + 1 < n) ? i + 1 : i], HASH_SIZE);
+            sha256_raw(pair, sizeof(pair), level[i / 2]);
+        }
+    }
+    memcpy(root, level[0], HASH_SIZE);
+    return 1;
+}
@@ -0,0 +1,207 @@
+#include "hex.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#define HEX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Coppie di cifre per ogni valore di byte: una copia da 2 byte per byte
+static const char hex_pairs_lower[513] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static const char hex_pairs_upper[513] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+// Valore di ogni carattere con il bit 0x10 acceso se è una cifra valida:
+// l'AND dei valori letti dice in un colpo solo se la stringa era valida
+#define HEX_DIGIT(v) (0x10 | (v))
+static const uint8_t hex_values[256] = {
+    ['0'] = HEX_DIGIT(0), ['1'] = HEX_DIGIT(1), ['2'] = HEX_DIGIT(2), ['3'] = HEX_DIGIT(3),
+    ['4'] = HEX_DIGIT(4), ['5'] = HEX_DIGIT(5), ['6'] = HEX_DIGIT(6), ['7'] = HEX_DIGIT(7),
+    ['8'] = HEX_DIGIT(8), ['9'] = HEX_DIGIT(9),
+    ['a'] = HEX_DIGIT(10), ['b'] = HEX_DIGIT(11), ['c'] = HEX_DIGIT(12),
+    ['d'] = HEX_DIGIT(13), ['e'] = HEX_DIGIT(14), ['f'] = HEX_DIGIT(15),
+    ['A'] = HEX_DIGIT(10), ['B'] = HEX_DIGIT(11), ['C'] = HEX_DIGIT(12),
+    ['D'] = HEX_DIGIT(13), ['E'] = HEX_DIGIT(14), ['F'] = HEX_DIGIT(15),
+};
+
+#ifdef HEX_SSE2
+// ---------------------------------------------------------
+// KERNEL SSE2 (16 byte <-> 32 cifre)
+// ---------------------------------------------------------
+// Nibble -> cifra: '0' + n, più lo scarto fino alle lettere se n > 9
+static __m128i nibbles_to_ascii(__m128i n, char alpha_skip) {
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8(alpha_skip));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), letters);
+}
+
+static void encode16(const uint8_t *in, char *out, char alpha_skip) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)in);
+    __m128i mask = _mm_set1_epi8(0x0F);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    __m128i lo = _mm_and_si128(bytes, mask);
+    // Interleave: cifra alta e bassa di ogni byte una accanto all'altra
+    _mm_storeu_si128((__m128i *)out, nibbles_to_ascii(_mm_unpacklo_epi8(hi, lo), alpha_skip));
+    _mm_storeu_si128((__m128i *)(out + 16), nibbles_to_ascii(_mm_unpackhi_epi8(hi, lo), alpha_skip));
+}
+
+// Confronti con segno: i caratteri >= 0x80 risultano negativi e quindi non validi
+static __m128i in_range(__m128i c, char first, char last) {
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8((char)(first - 1))),
+                         _mm_cmplt_epi8(c, _mm_set1_epi8((char)(last + 1))));
+}
+
+// Valori dei 16 caratteri; ritorna 1 se sono tutti cifre esadecimali
+static int ascii_to_nibbles(__m128i c, __m128i *values) {
+    __m128i folded = _mm_or_si128(c, _mm_set1_epi8(0x20));   // 'A'..'F' -> 'a'..'f'
+    __m128i is_digit = in_range(c, '0', '9');
+    __m128i is_letter = in_range(folded, 'a', 'f');
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10));
+    *values = _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_and_si128(is_letter, letter));
+    return _mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) == 0xFFFF;
+}
+
+// Coppie (alta, bassa) lette come u16 little-endian: (alta << 4) | bassa
+static __m128i pack_pairs(__m128i values) {
+    __m128i high = _mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00FF)), 4);
+    return _mm_or_si128(high, _mm_srli_epi16(values, 8));
+}
+
+static int decode16(const char *hex, uint8_t *out) {
+    __m128i first, second;
+    int ok = ascii_to_nibbles(_mm_loadu_si128((const __m128i *)hex), &first);
+    ok &= ascii_to_nibbles(_mm_loadu_si128((const __m128i *)(hex + 16)), &second);
+    _mm_storeu_si128((__m128i *)out, _mm_packus_epi16(pack_pairs(first), pack_pairs(second)));
+    return ok;
+}
+
+// Come decode16, accumulando in 'found' il case delle lettere incontrate
+static int decode16_case(const char *hex, uint8_t *out, int *found) {
+    __m128i first = _mm_loadu_si128((const __m128i *)hex);
+    __m128i second = _mm_loadu_si128((const __m128i *)(hex + 16));
+    __m128i lower = _mm_or_si128(in_range(first, 'a', 'f'), in_range(second, 'a', 'f'));
+    __m128i upper = _mm_or_si128(in_range(first, 'A', 'F'), in_range(second, 'A', 'F'));
+    if (_mm_movemask_epi8(lower)) *found |= HEX_HAS_LOWER;
+    if (_mm_movemask_epi8(upper)) *found |= HEX_HAS_UPPER;
+    return decode16(hex, out);
+}
+
+static int case16(const char *hex) {
+    __m128i c = _mm_loadu_si128((const __m128i *)hex);
+    int lower = _mm_movemask_epi8(in_range(c, 'a', 'f'));
+    int upper = _mm_movemask_epi8(in_range(c, 'A', 'F'));
+    if ((_mm_movemask_epi8(in_range(c, '0', '9')) | lower | upper) != 0xFFFF) return -1;
+    return (lower ? HEX_HAS_LOWER : 0) | (upper ? HEX_HAS_UPPER : 0);
+}
+#endif
+
+// ---------------------------------------------------------
+// CODIFICA
+// ---------------------------------------------------------
+static void encode(const uint8_t *in, size_t n, char *out, const char *pairs, char alpha_skip) {
+    size_t i = 0;
+#ifdef HEX_SSE2
+    for (; i + 16 <= n; i += 16) encode16(in + i, out + 2 * i, alpha_skip);
+#else
+    (void)alpha_skip;
+#endif
+    for (; i < n; i++) memcpy(out + 2 * i, pairs + 2 * in[i], 2);
+    out[2 * n] = '\0';
+}
+
+void hex_encode(const uint8_t *in, size_t n, char *out) {
+    encode(in, n, out, hex_pairs_lower, 'a' - '0' - 10);
+}
+
+void hex_encode_upper(const uint8_t *in, size_t n, char *out) {
+    encode(in, n, out, hex_pairs_upper, 'A' - '0' - 10);
+}
+
+// ---------------------------------------------------------
+// DECODIFICA
+// ---------------------------------------------------------
+// In caso di errore il contenuto di 'out' non è definito
+int hex_decode(const char *hex, uint8_t *out, size_t n) {
+    size_t i = 0;
+    int ok = 1;
+#ifdef HEX_SSE2
+    for (; i + 16 <= n; i += 16) ok &= decode16(hex + 2 * i, out + i);
+#endif
+    uint8_t valid = 0x10;
+    for (; i < n; i++) {
+        uint8_t hi = hex_values[(unsigned char)hex[2 * i]];
+        uint8_t lo = hex_values[(unsigned char)hex[2 * i + 1]];
+        valid &= hi & lo;
+        out[i] = (uint8_t)((hi << 4) | (lo & 0x0F));
+    }
+    return ok && valid;
+}
+
+int hex_decode_case(const char *hex, uint8_t *out, size_t n) {
+    size_t i = 0;
+    int ok = 1, found = 0;
+#ifdef HEX_SSE2
+    for (; i + 16 <= n; i += 16) ok &= decode16_case(hex + 2 * i, out + i, &found);
+#endif
+    if (!ok || !hex_decode(hex + 2 * i, out + i, n - i)) return -1;
+    int tail = hex_case(hex + 2 * i, 2 * (n - i));
+    return tail < 0 ? -1 : found | tail;
+}
+
+int hex_parse(const char *hex, uint8_t *out, size_t n) {
+    // Prima la lunghezza: i blocchi SSE2 non devono leggere oltre il terminatore
+    size_t len = 0;
+    while (len <= 2 * n && hex[len]) len++;
+    return len == 2 * n && hex_decode(hex, out, n);
+}
+
+int hex_case(const char *hex, size_t len) {
+    size_t i = 0;
+    int found = 0;
+#ifdef HEX_SSE2
+    for (; i + 16 <= len; i += 16) {
+        int c = case16(hex + i);
+        if (c < 0) return -1;
+        found |= c;
+    }
+#endif
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char)hex[i];
+        if (!hex_values[c]) return -1;
+        if (c >= 'a') found |= HEX_HAS_LOWER;
+        else if (c >= 'A') found |= HEX_HAS_UPPER;
+    }
+    return found;
+}
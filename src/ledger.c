@@ -0,0 +1,1181 @@
+#include "utils.h"
+#include "ledger.h"
+#include "hex.h"
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Writer: solo il segmento attivo (l'ultimo) è aperto in append
+static FILE *ledger_fp = NULL;
+static char ledger_path[512];
+static int *segment_fds = NULL;   // Un fd in lettura per segmento (pread)
+static int segment_count = 0;
+static long active_count = 0;     // Blocchi nel segmento attivo
+static uint64_t ledger_end = 0;   // Fine del segmento attivo
+
+static FILE *index_fp = NULL;
+static long index_count = 0;      // Blocchi nel ledger (anche con indice non valido)
+static char index_path_cur[512];
+static int index_dirty = 0;       // Indice non allineato: posizioni cercate scorrendo il ledger
+
+// ---------------------------------------------------------
+// WRITER / READER BINARI (Little-Endian)
+// ---------------------------------------------------------
+typedef struct {
+    unsigned char *p;
+    size_t len;
+    size_t cap;
+    int overflow;
+} ByteWriter;
+
+typedef struct {
+    const unsigned char *p;
+    size_t len;
+    size_t pos;
+    int error;
+} ByteReader;
+
+static void put_bytes(ByteWriter *w, const void *src, size_t n) {
+    if (w->overflow || w->len + n > w->cap) { w->overflow = 1; return; }
+    memcpy(w->p + w->len, src, n);
+    w->len += n;
+}
+
+static void put_uint(ByteWriter *w, uint64_t v, int width) {
+    unsigned char tmp[8];
+    for (int i = 0; i < width; i++) tmp[i] = (unsigned char)(v >> (8 * i));
+    put_bytes(w, tmp, width);
+}
+
+static const unsigned char *get_bytes(ByteReader *r, size_t n) {
+    if (r->error || r->pos + n > r->len) { r->error = 1; return NULL; }
+    const unsigned char *ptr = r->p + r->pos;
+    r->pos += n;
+    return ptr;
+}
+
+static uint64_t get_uint(ByteReader *r, int width) {
+    const unsigned char *b = get_bytes(r, width);
+    uint64_t v = 0;
+    if (!b) return 0;
+    for (int i = 0; i < width; i++) v |= (uint64_t)b[i] << (8 * i);
+    return v;
+}
+
+// Stringa con prefisso di lunghezza (u16), senza terminatore
+static void put_str(ByteWriter *w, const char *s, size_t max_len) {
+    size_t n = strnlen(s, max_len);
+    put_uint(w, n, 2);
+    put_bytes(w, s, n);
+}
+
+static void get_str(ByteReader *r, char *dst, size_t cap) {
+    size_t n = get_uint(r, 2);
+    const unsigned char *b = get_bytes(r, n);
+    if (!b || n >= cap) { r->error = 1; return; }
+    memcpy(dst, b, n);
+    dst[n] = '\0';
+}
+
+// ---------------------------------------------------------
+// CAMPI ESADECIMALI -> BINARIO
+// ---------------------------------------------------------
+// Tag: 0 = stringa grezza, 1 = hex minuscolo, 2 = hex maiuscolo.
+// Il case viene conservato: la stringa decodificata è identica byte per byte
+// all'originale, quindi il preimage di hashing non cambia.
+#define HEXTAG_RAW   0
+#define HEXTAG_LOWER 1
+#define HEXTAG_UPPER 2
+
+static void put_hexfield(ByteWriter *w, const char *s, size_t max_len) {
+    size_t n = strnlen(s, max_len);
+    int letters = (n % 2 == 0 && n / 2 <= 255) ? hex_case(s, n) : -1;
+
+    if (letters < 0 || letters == (HEX_HAS_LOWER | HEX_HAS_UPPER)) {
+        put_uint(w, HEXTAG_RAW, 1);
+        put_uint(w, n > 255 ? 255 : n, 1);
+        put_bytes(w, s, n > 255 ? 255 : n);
+        return;
+    }
+
+    uint8_t bin[255];
+    hex_decode(s, bin, n / 2);
+    put_uint(w, (letters & HEX_HAS_UPPER) ? HEXTAG_UPPER : HEXTAG_LOWER, 1);
+    put_uint(w, n / 2, 1);
+    put_bytes(w, bin, n / 2);
+}
+
+static void get_hexfield(ByteReader *r, char *dst, size_t cap) {
+    int tag = (int)get_uint(r, 1);
+    size_t n = get_uint(r, 1);
+    const unsigned char *b = get_bytes(r, n);
+    if (!b) return;
+
+    if (tag == HEXTAG_RAW) {
+        if (n >= cap) { r->error = 1; return; }
+        memcpy(dst, b, n);
+        dst[n] = '\0';
+        return;
+    }
+    if ((tag != HEXTAG_LOWER && tag != HEXTAG_UPPER) || n * 2 >= cap) { r->error = 1; return; }
+
+    if (tag == HEXTAG_UPPER) hex_encode_upper(b, n, dst);
+    else hex_encode(b, n, dst);
+}
+
+// Hash e firme sono già binari nel Block: stesso layout del campo hex
+// (tag + lunghezza + byte), quindi i record restano identici a quelli scritti
+// quando in RAM c'era la stringa. Solo il tag del case è fisso: minuscolo per
+// gli hash (entrano così nel preimage), maiuscolo per le firme.
+static void put_binfield(ByteWriter *w, const uint8_t *src, size_t n, int tag) {
+    put_uint(w, (uint64_t)tag, 1);
+    put_uint(w, n, 1);
+    put_bytes(w, src, n);
+}
+
+static void get_binfield(ByteReader *r, uint8_t *dst, size_t n, int allow_upper) {
+    int tag = (int)get_uint(r, 1);
+    size_t len = get_uint(r, 1);
+    const unsigned char *b = get_bytes(r, len);
+    if (!b) return;
+    if (len != n || !(tag == HEXTAG_LOWER || (allow_upper && tag == HEXTAG_UPPER))) { r->error = 1; return; }
+    memcpy(dst, b, n);
+}
+
+// ---------------------------------------------------------
+// PAYLOAD PER ACTIONTYPE
+// ---------------------------------------------------------
+static void encode_payload(ByteWriter *w, ActionType type, const ActionPayload *d) {
+    switch (type) {
+        case ACT_REGISTER_USER:
+            put_str(w, d->registration.username, sizeof(d->registration.username));
+            put_str(w, d->registration.bio, sizeof(d->registration.bio));
+            put_str(w, d->registration.pic_url, sizeof(d->registration.pic_url));
+            break;
+        case ACT_POST_CONTENT:
+            put_str(w, d->post.content, MAX_CONTENT_LEN);
+            break;
+        case ACT_POST_COMMENT:
+            put_uint(w, (uint32_t)d->comment.target_post_id, 4);
+            put_str(w, d->comment.content, MAX_CONTENT_LEN);
+            break;
+        case ACT_VOTE_COMMIT:
+            put_uint(w, (uint32_t)d->commit.target_post_id, 4);
+            put_binfield(w, d->commit.vote_hash, HASH_SIZE, HEXTAG_LOWER);
+            break;
+        case ACT_VOTE_REVEAL:
+            put_uint(w, (uint32_t)d->reveal.target_post_id, 4);
+            put_uint(w, (uint32_t)d->reveal.vote_value, 4);
+            put_str(w, d->reveal.salt_secret, sizeof(d->reveal.salt_secret));
+            break;
+        case ACT_FOLLOW_USER:
+            put_hexfield(w, d->follow.target_user_pubkey, SIGNATURE_LEN);
+            break;
+        case ACT_POST_FINALIZE:
+            put_uint(w, (uint32_t)d->finalize.target_post_id, 4);
+            break;
+        case ACT_TRANSFER:
+            put_hexfield(w, d->transfer.target_pubkey, SIGNATURE_LEN);
+            put_uint(w, (uint32_t)d->transfer.amount, 4);
+            break;
+        case ACT_BATCH:
+            put_uint(w, (uint32_t)d->batch.count, 2);
+            put_binfield(w, d->batch.merkle_root, HASH_SIZE, HEXTAG_LOWER);
+            break;
+        default:
+            break;
+    }
+}
+
+static void decode_payload(ByteReader *r, ActionType type, ActionPayload *d) {
+    switch (type) {
+        case ACT_REGISTER_USER:
+            get_str(r, d->registration.username, sizeof(d->registration.username));
+            get_str(r, d->registration.bio, sizeof(d->registration.bio));
+            get_str(r, d->registration.pic_url, sizeof(d->registration.pic_url));
+            break;
+        case ACT_POST_CONTENT:
+            get_str(r, d->post.content, MAX_CONTENT_LEN);
+            break;
+        case ACT_POST_COMMENT:
+            d->comment.target_post_id = (int32_t)get_uint(r, 4);
+            get_str(r, d->comment.content, MAX_CONTENT_LEN);
+            break;
+        case ACT_VOTE_COMMIT:
+            d->commit.target_post_id = (int32_t)get_uint(r, 4);
+            get_binfield(r, d->commit.vote_hash, HASH_SIZE, 0);
+            break;
+        case ACT_VOTE_REVEAL:
+            d->reveal.target_post_id = (int32_t)get_uint(r, 4);
+            d->reveal.vote_value = (int32_t)get_uint(r, 4);
+            get_str(r, d->reveal.salt_secret, sizeof(d->reveal.salt_secret));
+            break;
+        case ACT_FOLLOW_USER:
+            get_hexfield(r, d->follow.target_user_pubkey, SIGNATURE_LEN);
+            break;
+        case ACT_POST_FINALIZE:
+            d->finalize.target_post_id = (int32_t)get_uint(r, 4);
+            break;
+        case ACT_TRANSFER:
+            get_hexfield(r, d->transfer.target_pubkey, SIGNATURE_LEN);
+            d->transfer.amount = (int32_t)get_uint(r, 4);
+            break;
+        case ACT_BATCH:
+            d->batch.count = (int)get_uint(r, 2);
+            get_binfield(r, d->batch.merkle_root, HASH_SIZE, 0);
+            if (d->batch.count < 1 || d->batch.count > MAX_BLOCK_ACTIONS) r->error = 1;
+            break;
+        default:
+            break;
+    }
+}
+
+// Azioni di un ACT_BATCH, in coda al payload del blocco:
+//   per azione [u8 type][pubkey][firma][payload per ActionType]
+static void encode_actions(ByteWriter *w, const Block *b) {
+    for (int i = 0; i < b->data.batch.count; i++) {
+        const Action *a = &b->actions[i];
+        put_uint(w, (uint8_t)a->type, 1);
+        put_hexfield(w, a->sender_pubkey, SIGNATURE_LEN);
+        put_binfield(w, a->signature, SIG_SIZE, HEXTAG_UPPER);
+        encode_payload(w, a->type, &a->data);
+    }
+}
+
+// L'array del Block viene riusato: realloc non sposta nulla se il batch
+// precedente era grande almeno quanto questo.
+static void decode_actions(ByteReader *r, Block *b) {
+    if (r->error) return;
+    Action *actions = realloc(b->actions, (size_t)b->data.batch.count * sizeof(Action));
+    if (!actions) fatal_error("Out of memory! Failed to allocate %d batch actions.", b->data.batch.count);
+    b->actions = actions;
+    for (int i = 0; i < b->data.batch.count && !r->error; i++) {
+        Action *a = &b->actions[i];
+        memset(a, 0, sizeof(Action));
+        a->type = (ActionType)get_uint(r, 1);
+        if (a->type >= ACT_BATCH) { r->error = 1; return; } // Niente batch annidati
+        get_hexfield(r, a->sender_pubkey, SIGNATURE_LEN);
+        get_binfield(r, a->signature, SIG_SIZE, 1);
+        decode_payload(r, a->type, &a->data);
+    }
+}
+
+// ---------------------------------------------------------
+// CODIFICA BLOCCO (corpo del record v2)
+// ---------------------------------------------------------
+size_t ledger_encode_block(const Block *block, unsigned char *buf, size_t cap) {
+    ByteWriter w = { .p = buf, .len = 0, .cap = cap, .overflow = 0 };
+
+    put_uint(&w, (uint8_t)block->type, 1);
+    put_uint(&w, (uint32_t)block->index, 4);
+    put_uint(&w, (uint64_t)(int64_t)block->timestamp, 8);
+    put_uint(&w, (uint32_t)block->nonce, 4);
+    put_binfield(&w, block->prev_hash, HASH_SIZE, HEXTAG_LOWER);
+    put_binfield(&w, block->curr_hash, HASH_SIZE, HEXTAG_LOWER);
+    put_hexfield(&w, block->sender_pubkey, SIGNATURE_LEN);
+    put_binfield(&w, block->signature, SIG_SIZE, HEXTAG_UPPER);
+
+    // Payload con prefisso di lunghezza: un lettore può saltarlo senza capirlo
+    size_t len_pos = w.len;
+    put_uint(&w, 0, 2);
+    size_t payload_start = w.len;
+    encode_payload(&w, block->type, &block->data);
+    if (block->type == ACT_BATCH) encode_actions(&w, block);
+    if (w.overflow) return 0;
+
+    size_t payload_len = w.len - payload_start;
+    buf[len_pos] = (unsigned char)(payload_len & 0xFF);
+    buf[len_pos + 1] = (unsigned char)(payload_len >> 8);
+
+    // Difficoltà in coda, assente per i blocchi legacy
+    if (block->difficulty) put_uint(&w, block->difficulty, 1);
+    return w.overflow ? 0 : w.len;
+}
+
+// ---------------------------------------------------------
+// DECODIFICA BLOCCO
+// ---------------------------------------------------------
+int ledger_decode_block(const unsigned char *buf, size_t len, Block *out) {
+    ByteReader r = { .p = buf, .len = len, .pos = 0, .error = 0 };
+    Action *actions = out->actions; // Buffer dei batch già decodificati in questo Block
+    memset(out, 0, sizeof(Block));
+    out->actions = actions;
+
+    out->type = (ActionType)get_uint(&r, 1);
+    out->index = (int32_t)get_uint(&r, 4);
+    out->timestamp = (time_t)(int64_t)get_uint(&r, 8);
+    out->nonce = (int32_t)get_uint(&r, 4);
+    get_binfield(&r, out->prev_hash, HASH_SIZE, 0);
+    get_binfield(&r, out->curr_hash, HASH_SIZE, 0);
+    get_hexfield(&r, out->sender_pubkey, SIGNATURE_LEN);
+    get_binfield(&r, out->signature, SIG_SIZE, 1);
+
+    size_t payload_len = get_uint(&r, 2);
+    if (r.error || r.pos + payload_len > len) return 0;
+
+    ByteReader pr = { .p = buf + r.pos, .len = payload_len, .pos = 0, .error = 0 };
+    decode_payload(&pr, out->type, &out->data);
+    if (out->type == ACT_BATCH) decode_actions(&pr, out);
+    if (pr.error || pr.pos != payload_len) return 0;
+
+    size_t trailer = len - r.pos - payload_len;
+    if (trailer == 1) out->difficulty = buf[len - 1];
+    return trailer == 0 || (trailer == 1 && out->difficulty != 0);
+}
+
+// ---------------------------------------------------------
+// RICONOSCIMENTO FORMATO
+// ---------------------------------------------------------
+int ledger_detect_format(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return LEDGER_FORMAT_NONE;
+
+    unsigned char hdr[LEDGER_HEADER_SIZE];
+    size_t n = fread(hdr, 1, sizeof(hdr), f);
+    fclose(f);
+
+    if (n == 0) return LEDGER_FORMAT_NONE;
+    if (n >= 4 && memcmp(hdr, LEDGER_MAGIC, 4) == 0) return LEDGER_FORMAT_COMPACT;
+    if (n < 4 && memcmp(hdr, LEDGER_MAGIC, n) == 0) return LEDGER_FORMAT_NONE; // Header troncato
+    return LEDGER_FORMAT_LEGACY;
+}
+
+static int write_file_header(FILE *f) {
+    unsigned char hdr[LEDGER_HEADER_SIZE] = {0};
+    memcpy(hdr, LEDGER_MAGIC, 4);
+    hdr[4] = LEDGER_FORMAT_COMPACT;
+    return fwrite(hdr, sizeof(hdr), 1, f) == 1;
+}
+
+static int write_record(FILE *f, const Block *block) {
+    unsigned char rec[LEDGER_RECORD_HEADER + LEDGER_MAX_RECORD];
+    size_t body_len = ledger_encode_block(block, rec + LEDGER_RECORD_HEADER, LEDGER_MAX_RECORD);
+    if (body_len == 0) return 0;
+
+    uint32_t crc = crc32_update(0, rec + LEDGER_RECORD_HEADER, body_len);
+    for (int i = 0; i < 4; i++) {
+        rec[i] = (unsigned char)(body_len >> (8 * i));
+        rec[4 + i] = (unsigned char)(crc >> (8 * i));
+    }
+    return fwrite(rec, LEDGER_RECORD_HEADER + body_len, 1, f) == 1;
+}
+
+// ---------------------------------------------------------
+// CONVERTITORE LEGACY (v1 -> v2)
+// ---------------------------------------------------------
+// Layout della struct Block del formato v1, con hash e firme in hex
+typedef struct {
+    int target_post_id;
+    char vote_hash[HASH_LEN];
+} LegacyPayloadCommit;
+
+typedef struct LegacyBlock {
+    int index;
+    time_t timestamp;
+    char prev_hash[HASH_LEN];
+    char curr_hash[HASH_LEN];
+    ActionType type;
+    char sender_pubkey[SIGNATURE_LEN];
+    char signature[SIGNATURE_LEN];
+    int nonce;
+
+    union {
+        PayloadPost post;
+        LegacyPayloadCommit commit;
+        PayloadReveal reveal;
+        PayloadComment comment;
+        PayloadFollow follow;
+        PayloadRegister registration;
+        PayloadFinalize finalize;
+        PayloadTransfer transfer;
+    } data;
+
+    struct LegacyBlock *next;
+} LegacyBlock;
+
+static int legacy_to_block(const LegacyBlock *lb, Block *b) {
+    memset(b, 0, sizeof(Block));
+    b->index = lb->index;
+    b->timestamp = lb->timestamp;
+    b->type = lb->type;
+    b->nonce = lb->nonce;
+    snprintf(b->sender_pubkey, sizeof(b->sender_pubkey), "%.*s", SIGNATURE_LEN - 1, lb->sender_pubkey);
+
+    if (lb->type == ACT_VOTE_COMMIT) {
+        char vote_hash[HASH_LEN];
+        snprintf(vote_hash, sizeof(vote_hash), "%.*s", HASH_LEN - 1, lb->data.commit.vote_hash);
+        b->data.commit.target_post_id = lb->data.commit.target_post_id;
+        if (!hex_parse(vote_hash, b->data.commit.vote_hash, HASH_SIZE)) return 0;
+    } else {
+        memcpy(&b->data, &lb->data, sizeof(b->data));
+    }
+
+    char prev[HASH_LEN], curr[HASH_LEN], sig[SIGNATURE_LEN];
+    snprintf(prev, sizeof(prev), "%.*s", HASH_LEN - 1, lb->prev_hash);
+    snprintf(curr, sizeof(curr), "%.*s", HASH_LEN - 1, lb->curr_hash);
+    snprintf(sig, sizeof(sig), "%.*s", SIGNATURE_LEN - 1, lb->signature);
+    return hex_parse(prev, b->prev_hash, HASH_SIZE) &&
+           hex_parse(curr, b->curr_hash, HASH_SIZE) &&
+           hex_parse(sig, b->signature, SIG_SIZE);
+}
+
+long ledger_convert_legacy(const char *legacy_path, const char *out_path) {
+    FILE *in = fopen(legacy_path, "rb");
+    if (!in) return -1;
+    FILE *out = fopen(out_path, "wb");
+    if (!out) { fclose(in); return -1; }
+
+    long count = 0;
+    int ok = write_file_header(out);
+    LegacyBlock lb;
+    Block b;
+    while (ok && fread(&lb, sizeof(LegacyBlock), 1, in) == 1) {
+        ok = legacy_to_block(&lb, &b) && write_record(out, &b);
+        count++;
+    }
+    fclose(in);
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0) ok = 0;
+    fclose(out);
+
+    if (!ok) {
+        remove(out_path);
+        return -1;
+    }
+    return count;
+}
+
+// Migra sul posto, lasciando una copia del file originale in '<path>.legacy'
+int ledger_upgrade_legacy(const char *path) {
+    char tmp_path[512], bak_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    snprintf(bak_path, sizeof(bak_path), "%s.legacy", path);
+
+    long count = ledger_convert_legacy(path, tmp_path);
+    if (count < 0) {
+        fprintf(stderr, "[LEDGER] ❌ Conversione del formato legacy fallita.\n");
+        return 0;
+    }
+    if (rename(path, bak_path) != 0 || rename(tmp_path, path) != 0) {
+        perror("[LEDGER] rename");
+        return 0;
+    }
+    printf("[LEDGER] Chain convertita al formato compatto v%d (%ld blocchi). Backup: '%s'.\n",
+           LEDGER_FORMAT_COMPACT, count, bak_path);
+    return 1;
+}
+
+// ---------------------------------------------------------
+// FRAME DI UN RECORD
+// ---------------------------------------------------------
+// Ritorna la lunghezza del corpo del record a 'offset', oppure 0 se il record
+// è incompleto o il CRC non torna.
+static uint32_t record_body_len(const unsigned char *base, size_t size, size_t offset) {
+    if (offset + LEDGER_RECORD_HEADER > size) return 0;
+
+    const unsigned char *h = base + offset;
+    uint32_t len = 0, crc = 0;
+    for (int i = 0; i < 4; i++) {
+        len |= (uint32_t)h[i] << (8 * i);
+        crc |= (uint32_t)h[4 + i] << (8 * i);
+    }
+    if (len == 0 || len > LEDGER_MAX_RECORD || offset + LEDGER_RECORD_HEADER + len > size) return 0;
+    if (crc32_update(0, h + LEDGER_RECORD_HEADER, len) != crc) return 0;
+    return len;
+}
+
+// ---------------------------------------------------------
+// SEGMENTI
+// ---------------------------------------------------------
+// Segmento 0 = 'wwyl_chain.dat' (compatibile con il file unico di prima),
+// poi 'wwyl_chain.dat.1', 'wwyl_chain.dat.2', ...
+static void segment_path(const char *base_path, int seg, char *out, size_t cap) {
+    if (seg == 0) snprintf(out, cap, "%s", base_path);
+    else snprintf(out, cap, "%s.%d", base_path, seg);
+}
+
+static void encode_footer(const SegmentFooter *ft, unsigned char *buf) {
+    ByteWriter w = { .p = buf, .len = 0, .cap = LEDGER_FOOTER_SIZE, .overflow = 0 };
+    put_bytes(&w, LEDGER_FOOTER_MAGIC, 4);
+    put_uint(&w, (uint32_t)ft->first_height, 4);
+    put_uint(&w, (uint32_t)ft->last_height, 4);
+    put_bytes(&w, ft->first_hash, HASH_SIZE);
+    put_bytes(&w, ft->last_hash, HASH_SIZE);
+    put_uint(&w, ft->records_len, 8);
+    put_uint(&w, ft->last_offset, 8);
+    put_uint(&w, ft->records_crc, 4);
+    put_uint(&w, crc32_update(0, buf, w.len), 4);
+}
+
+// Il footer vale solo se è integro e descrive esattamente il file che lo contiene
+static int decode_footer(const unsigned char *buf, uint64_t file_size, SegmentFooter *ft) {
+    ByteReader r = { .p = buf, .len = LEDGER_FOOTER_SIZE, .pos = 0, .error = 0 };
+    if (memcmp(buf, LEDGER_FOOTER_MAGIC, 4) != 0) return 0;
+    get_bytes(&r, 4);
+    ft->first_height = (int32_t)get_uint(&r, 4);
+    ft->last_height = (int32_t)get_uint(&r, 4);
+    memcpy(ft->first_hash, get_bytes(&r, HASH_SIZE), HASH_SIZE);
+    memcpy(ft->last_hash, get_bytes(&r, HASH_SIZE), HASH_SIZE);
+    ft->records_len = get_uint(&r, 8);
+    ft->last_offset = get_uint(&r, 8);
+    ft->records_crc = (uint32_t)get_uint(&r, 4);
+    size_t body = r.pos;
+    uint32_t crc = (uint32_t)get_uint(&r, 4);
+
+    return !r.error && crc == crc32_update(0, buf, body) &&
+           ft->first_height >= 0 && ft->last_height >= ft->first_height &&
+           LEDGER_HEADER_SIZE + ft->records_len + LEDGER_FOOTER_SIZE == file_size &&
+           ft->last_offset >= LEDGER_HEADER_SIZE && ft->last_offset < LEDGER_HEADER_SIZE + ft->records_len;
+}
+
+// ---------------------------------------------------------
+// MMAP DEL LEDGER + TORN-TAIL RECOVERY
+// ---------------------------------------------------------
+// Ogni segmento viene mappato in sola lettura. I segmenti sigillati si
+// validano con il CRC del footer (in parallelo, un segmento per thread);
+// l'ultimo, se non sigillato, è quello attivo: si scorrono i frame
+// (lunghezza + CRC) e il primo record incompleto o corrotto segna la fine
+// del ledger valido, la vista viene limitata a quel punto e il file troncato.
+typedef struct {
+    LedgerView *view;
+    SegmentFooter *footers;
+    atomic_int next;
+    atomic_int failed;
+} SegmentCheckJob;
+
+static void *segment_check_worker(void *arg) {
+    SegmentCheckJob *job = arg;
+    int seg;
+    while ((seg = atomic_fetch_add(&job->next, 1)) < job->view->seg_count) {
+        const LedgerSegment *s = &job->view->segs[seg];
+        if (!s->sealed) continue;
+        if (crc32_update(0, s->base + LEDGER_HEADER_SIZE, s->size - LEDGER_HEADER_SIZE) != job->footers[seg].records_crc) {
+            fprintf(stderr, "[LEDGER] ❌ CRC errato nel segmento sigillato %d.\n", seg);
+            atomic_store(&job->failed, 1);
+        }
+    }
+    return NULL;
+}
+
+static int check_sealed_segments(LedgerView *view, SegmentFooter *footers) {
+    SegmentCheckJob job = { .view = view, .footers = footers };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.failed, 0);
+
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > view->seg_count) n = view->seg_count;
+    if (n > LEDGER_MAX_LOAD_THREADS) n = LEDGER_MAX_LOAD_THREADS;
+
+    crc32_update(0, NULL, 0); // Inizializza la tabella prima di avviare i thread
+    pthread_t workers[LEDGER_MAX_LOAD_THREADS];
+    int started = 0;
+    for (long i = 1; i < n; i++) {
+        if (pthread_create(&workers[started], NULL, segment_check_worker, &job) == 0) started++;
+    }
+    segment_check_worker(&job);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    return !atomic_load(&job.failed);
+}
+
+// Mappa un segmento. Ritorna 1 se ok, 0 se il file non esiste, -1 se non è leggibile.
+static int map_segment(const char *path, int is_last, LedgerSegment *seg, SegmentFooter *ft) {
+    memset(seg, 0, sizeof(LedgerSegment));
+    seg->fd = -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    // Segmento attivo appena creato (header incompleto): vuoto, lo sistema ledger_open
+    if (st.st_size < LEDGER_HEADER_SIZE) {
+        close(fd);
+        return is_last ? 1 : -1;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("[LEDGER] mmap");
+        close(fd);
+        return -1;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    seg->fd = fd;
+    seg->base = map;
+    seg->map_len = (size_t)st.st_size;
+    if (memcmp(seg->base, LEDGER_MAGIC, 4) != 0) return -1;
+
+    if (seg->map_len >= LEDGER_HEADER_SIZE + LEDGER_FOOTER_SIZE &&
+        decode_footer(seg->base + seg->map_len - LEDGER_FOOTER_SIZE, seg->map_len, ft)) {
+        seg->sealed = 1;
+        seg->size = seg->map_len - LEDGER_FOOTER_SIZE;
+        seg->count = ft->last_height - ft->first_height + 1;
+        seg->last_offset = ft->last_offset;
+        return 1;
+    }
+    // Solo l'ultimo segmento può essere privo di footer
+    if (!is_last) return -1;
+
+    size_t offset = LEDGER_HEADER_SIZE;
+    uint32_t len;
+    while ((len = record_body_len(seg->base, seg->map_len, offset)) > 0) {
+        seg->last_offset = offset;
+        seg->count++;
+        offset += LEDGER_RECORD_HEADER + len;
+    }
+    seg->size = offset;
+
+    if (offset != seg->map_len) {
+        fprintf(stderr, "[LEDGER] ⚠️ Record incompleto o corrotto dopo %ld blocchi. Tronco il ledger.\n",
+                seg->count);
+        // Le pagine oltre 'offset' non verranno più toccate: troncare è sicuro
+        if (truncate(path, (off_t)offset) != 0) perror("[LEDGER] truncate");
+    }
+    return 1;
+}
+
+// Ritorna 1 se la chain è stata mappata, 0 se non esiste, -1 se un segmento
+// sigillato (o intermedio) è corrotto: in quel caso non si deve ripartire da zero.
+int ledger_map(const char *path, LedgerView *view) {
+    memset(view, 0, sizeof(LedgerView));
+
+    char seg_path[512];
+    int total = 0;
+    segment_path(path, 0, seg_path, sizeof(seg_path));
+    while (access(seg_path, F_OK) == 0) {
+        segment_path(path, ++total, seg_path, sizeof(seg_path));
+    }
+    if (total == 0) return 0;
+
+    view->segs = safe_zalloc((size_t)total * sizeof(LedgerSegment));
+    SegmentFooter *footers = safe_zalloc((size_t)total * sizeof(SegmentFooter));
+    int rc = 1;
+
+    for (int i = 0; i < total && rc == 1; i++) {
+        segment_path(path, i, seg_path, sizeof(seg_path));
+        view->seg_count = i + 1;
+        if (map_segment(seg_path, i == total - 1, &view->segs[i], &footers[i]) != 1) {
+            fprintf(stderr, "[LEDGER] ❌ Segmento '%s' illeggibile o senza footer.\n", seg_path);
+            rc = -1;
+            break;
+        }
+        // Il range del footer deve proseguire esattamente dal segmento precedente
+        if (view->segs[i].sealed && footers[i].first_height != view->count) {
+            fprintf(stderr, "[LEDGER] ❌ Segmento '%s' fuori sequenza (#%d, atteso #%ld).\n",
+                    seg_path, footers[i].first_height, view->count);
+            rc = -1;
+            break;
+        }
+        if (view->segs[i].count > 0) view->last_offset = LEDGER_LOC(i, view->segs[i].last_offset);
+        view->count += view->segs[i].count;
+        view->size += view->segs[i].size;
+    }
+    if (rc == 1 && !check_sealed_segments(view, footers)) rc = -1;
+    free(footers);
+
+    if (rc != 1 || view->count == 0) {
+        ledger_unmap(view);
+        return rc == 1 ? 0 : -1;
+    }
+    return 1;
+}
+
+void ledger_unmap(LedgerView *view) {
+    for (int i = 0; i < view->seg_count; i++) {
+        if (view->segs[i].base) munmap((void *)view->segs[i].base, view->segs[i].map_len);
+        if (view->segs[i].fd >= 0) close(view->segs[i].fd);
+    }
+    free(view->segs);
+    memset(view, 0, sizeof(LedgerView));
+}
+
+// ---------------------------------------------------------
+// CURSORE SUI RECORD MAPPATI
+// ---------------------------------------------------------
+void ledger_cursor_init(LedgerCursor *cursor, const LedgerView *view) {
+    cursor->view = view;
+    cursor->offset = LEDGER_LOC(0, LEDGER_HEADER_SIZE);
+}
+
+// Decodifica il record alla posizione 'loc' in 'out' (CRC già validato da ledger_map)
+int ledger_read_block_at(const LedgerView *view, size_t loc, Block *out) {
+    size_t seg_no = LEDGER_LOC_SEG(loc), offset = LEDGER_LOC_OFF(loc);
+    if (seg_no >= (size_t)view->seg_count) return 0;
+
+    const LedgerSegment *seg = &view->segs[seg_no];
+    if (!seg->base || offset + LEDGER_RECORD_HEADER > seg->size) return 0;
+
+    const unsigned char *h = seg->base + offset;
+    uint32_t len = 0;
+    for (int i = 0; i < 4; i++) len |= (uint32_t)h[i] << (8 * i);
+    if (offset + LEDGER_RECORD_HEADER + len > seg->size) return 0;
+
+    return ledger_decode_block(h + LEDGER_RECORD_HEADER, len, out);
+}
+
+// Ritorna 1 se ha prodotto un blocco, 0 a fine ledger, -1 se il record non è decodificabile
+int ledger_cursor_next(LedgerCursor *cursor, Block *out) {
+    const LedgerView *view = cursor->view;
+    size_t seg_no = LEDGER_LOC_SEG(cursor->offset);
+
+    // Fine segmento: si passa all'header del successivo
+    while (seg_no < (size_t)view->seg_count && LEDGER_LOC_OFF(cursor->offset) >= view->segs[seg_no].size) {
+        cursor->offset = LEDGER_LOC(++seg_no, LEDGER_HEADER_SIZE);
+    }
+    if (seg_no >= (size_t)view->seg_count) return 0;
+
+    if (!ledger_read_block_at(view, cursor->offset, out)) return -1;
+
+    const unsigned char *h = view->segs[seg_no].base + LEDGER_LOC_OFF(cursor->offset);
+    uint32_t len = 0;
+    for (int i = 0; i < 4; i++) len |= (uint32_t)h[i] << (8 * i);
+    cursor->offset += LEDGER_RECORD_HEADER + len;
+    return 1;
+}
+
+// Posizione di ogni record della vista (per l'accesso casuale dei verificatori
+// paralleli). Legge solo i frame, senza decodificare. Il chiamante fa free().
+size_t *ledger_view_offsets(const LedgerView *view) {
+    size_t *offsets = safe_zalloc((size_t)(view->count > 0 ? view->count : 1) * sizeof(size_t));
+    long n = 0;
+
+    for (int s = 0; s < view->seg_count; s++) {
+        const LedgerSegment *seg = &view->segs[s];
+        size_t offset = LEDGER_HEADER_SIZE;
+        for (long i = 0; i < seg->count && n < view->count; i++) {
+            const unsigned char *h = seg->base + offset;
+            uint32_t len = 0;
+            for (int k = 0; k < 4; k++) len |= (uint32_t)h[k] << (8 * k);
+            offsets[n++] = LEDGER_LOC(s, offset);
+            offset += LEDGER_RECORD_HEADER + len;
+        }
+    }
+    return offsets;
+}
+
+// ---------------------------------------------------------
+// INDICE ALTEZZA -> POSIZIONE (wwyl_chain.idx)
+// ---------------------------------------------------------
+// Header "WIDX" + versione, poi un u64 per blocco: posizione (segmento +
+// offset) del record con index == h. Con un solo segmento coincide con
+// l'offset nel file. È un dato derivato: se non combacia con il ledger si
+// ricostruisce.
+static int read_u64_at(int fd, off_t pos, uint64_t *out) {
+    unsigned char b[8];
+    if (pread(fd, b, sizeof(b), pos) != (ssize_t)sizeof(b)) return 0;
+    *out = 0;
+    for (int i = 0; i < 8; i++) *out |= (uint64_t)b[i] << (8 * i);
+    return 1;
+}
+
+static int read_record_len(int fd, uint64_t offset, uint32_t *len) {
+    unsigned char h[4];
+    if (pread(fd, h, sizeof(h), (off_t)offset) != (ssize_t)sizeof(h)) return 0;
+    *len = 0;
+    for (int i = 0; i < 4; i++) *len |= (uint32_t)h[i] << (8 * i);
+    return *len > 0 && *len <= LEDGER_MAX_RECORD;
+}
+
+// Fine dei record di un segmento: footer escluso per i sigillati
+static uint64_t segment_data_end(int seg) {
+    if (seg == segment_count - 1) return ledger_end;
+    struct stat st;
+    if (fstat(segment_fds[seg], &st) != 0 || st.st_size < LEDGER_HEADER_SIZE + LEDGER_FOOTER_SIZE) return 0;
+    return (uint64_t)st.st_size - LEDGER_FOOTER_SIZE;
+}
+
+static int index_append_offset(uint64_t loc) {
+    unsigned char b[8];
+    for (int i = 0; i < 8; i++) b[i] = (unsigned char)(loc >> (8 * i));
+    if (fwrite(b, sizeof(b), 1, index_fp) != 1 || fflush(index_fp) != 0) return 0;
+    index_count++;
+    return 1;
+}
+
+// L'indice è valido se ha un numero intero di voci e l'ultima punta
+// all'ultimo record della chain (che deve chiudere il suo segmento)
+static int index_matches_ledger(int idx_fd) {
+    struct stat st;
+    if (fstat(idx_fd, &st) != 0 || st.st_size < LEDGER_INDEX_HEADER) return 0;
+    if ((st.st_size - LEDGER_INDEX_HEADER) % 8 != 0) return 0;
+
+    unsigned char hdr[LEDGER_INDEX_HEADER];
+    if (pread(idx_fd, hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || memcmp(hdr, LEDGER_INDEX_MAGIC, 4) != 0) return 0;
+
+    long entries = (long)((st.st_size - LEDGER_INDEX_HEADER) / 8);
+    if (entries == 0) return segment_count == 1 && ledger_end == LEDGER_HEADER_SIZE;
+
+    uint64_t last = 0;
+    uint32_t len = 0;
+    if (!read_u64_at(idx_fd, LEDGER_INDEX_HEADER + (off_t)(entries - 1) * 8, &last)) return 0;
+
+    int seg = (int)LEDGER_LOC_SEG(last);
+    uint64_t offset = LEDGER_LOC_OFF(last);
+    if (seg >= segment_count) return 0;
+    // Dopo il segmento dell'ultima voce può esserci solo il segmento attivo vuoto
+    if (seg < segment_count - 1 && !(seg == segment_count - 2 && ledger_end == LEDGER_HEADER_SIZE)) return 0;
+    if (!read_record_len(segment_fds[seg], offset, &len)) return 0;
+    if (offset + LEDGER_RECORD_HEADER + len != segment_data_end(seg)) return 0;
+
+    index_count = entries;
+    return 1;
+}
+
+// Ricostruzione: scorre solo gli header dei record (8 byte ciascuno)
+static int index_rebuild(const char *index_path) {
+    if (index_fp) fclose(index_fp);
+    index_fp = fopen(index_path, "w+b");
+    if (!index_fp) return 0;
+    index_count = 0;
+
+    unsigned char hdr[LEDGER_INDEX_HEADER] = {0};
+    memcpy(hdr, LEDGER_INDEX_MAGIC, 4);
+    hdr[4] = LEDGER_FORMAT_COMPACT;
+    if (fwrite(hdr, sizeof(hdr), 1, index_fp) != 1) return 0;
+
+    for (int seg = 0; seg < segment_count; seg++) {
+        uint64_t end = segment_data_end(seg);
+        uint64_t offset = LEDGER_HEADER_SIZE;
+        uint32_t len = 0;
+        while (offset < end && read_record_len(segment_fds[seg], offset, &len)) {
+            if (!index_append_offset(LEDGER_LOC(seg, offset))) return 0;
+            offset += LEDGER_RECORD_HEADER + len;
+        }
+    }
+    node_printf("[LEDGER] Indice blocchi ricostruito (%ld voci).\n", index_count);
+    return fflush(index_fp) == 0;
+}
+
+// Scrittura dell'indice fallita dopo l'append: il file viene riportato
+// all'ultima voce valida (una voce parziale sposterebbe tutte le successive)
+// e ricostruito subito. Se anche la ricostruzione fallisce l'indice resta
+// marcato non valido e le posizioni si cercano scorrendo il ledger, finché
+// un append successivo non riesce a ricostruirlo.
+static void index_repair(void) {
+    long blocks = index_count;
+    if (index_fp) {
+        if (ftruncate(fileno(index_fp), LEDGER_INDEX_HEADER + (off_t)(blocks - 1) * 8) != 0) {
+            perror("[LEDGER] ftruncate indice");
+        }
+        clearerr(index_fp);
+    }
+    if (index_rebuild(index_path_cur) && index_count == blocks) {
+        index_dirty = 0;
+        return;
+    }
+    index_count = blocks;
+    if (!index_dirty) fprintf(stderr, "[LEDGER] ⚠️ Indice non valido: accesso per altezza tramite scansione del ledger.\n");
+    index_dirty = 1;
+}
+
+// Fallback senza indice: scorre gli header dei record (8 byte ciascuno)
+static int ledger_scan_loc(long height, uint64_t *loc) {
+    long h = 0;
+    for (int seg = 0; seg < segment_count; seg++) {
+        uint64_t end = segment_data_end(seg);
+        uint64_t offset = LEDGER_HEADER_SIZE;
+        uint32_t len = 0;
+        while (offset < end && read_record_len(segment_fds[seg], offset, &len)) {
+            if (h++ == height) {
+                *loc = LEDGER_LOC(seg, offset);
+                return 1;
+            }
+            offset += LEDGER_RECORD_HEADER + len;
+        }
+    }
+    return 0;
+}
+
+// Posizione del record all'altezza 'height' (0 <= height < index_count)
+static int index_loc(long height, uint64_t *loc) {
+    if (index_dirty) return ledger_scan_loc(height, loc);
+    if (!index_fp) return 0;
+    return read_u64_at(fileno(index_fp), LEDGER_INDEX_HEADER + (off_t)height * 8, loc);
+}
+
+// ---------------------------------------------------------
+// ACCESSO DIRETTO PER ALTEZZA (O(1))
+// ---------------------------------------------------------
+// Legge il record alla posizione 'loc' con pread e ne controlla il CRC
+static int read_record_at(uint64_t loc, Block *out) {
+    int seg = (int)LEDGER_LOC_SEG(loc);
+    uint64_t offset = LEDGER_LOC_OFF(loc);
+    uint32_t len = 0;
+    if (seg >= segment_count || !read_record_len(segment_fds[seg], offset, &len)) return 0;
+
+    unsigned char rec[LEDGER_RECORD_HEADER + LEDGER_MAX_RECORD];
+    size_t total = LEDGER_RECORD_HEADER + len;
+    if (pread(segment_fds[seg], rec, total, (off_t)offset) != (ssize_t)total) return 0;
+
+    uint32_t crc = 0;
+    for (int i = 0; i < 4; i++) crc |= (uint32_t)rec[4 + i] << (8 * i);
+    if (crc32_update(0, rec + LEDGER_RECORD_HEADER, len) != crc) return -1;
+    return ledger_decode_block(rec + LEDGER_RECORD_HEADER, len, out);
+}
+
+// Due pread sull'indice e sul segmento: nessuna scansione della catena e
+// nessun blocco residente in RAM oltre a quello richiesto.
+int get_block_by_index(int index, Block *out) {
+    if (index < 0 || index >= index_count) return 0;
+
+    uint64_t loc = 0;
+    if (!index_loc(index, &loc)) return 0;
+
+    int rc = read_record_at(loc, out);
+    if (rc < 0) {
+        fprintf(stderr, "[LEDGER] ❌ CRC errato per il blocco #%d.\n", index);
+        return 0;
+    }
+    return rc == 1 && out->index == index;
+}
+
+// ---------------------------------------------------------
+// SEEK DEL CURSORE PER ALTEZZA
+// ---------------------------------------------------------
+// Un'altezza oltre l'ultimo blocco porta il cursore a fine ledger.
+int ledger_cursor_seek(LedgerCursor *cursor, int height) {
+    if (height <= 0) {
+        cursor->offset = LEDGER_LOC(0, LEDGER_HEADER_SIZE);
+        return 1;
+    }
+    if (!index_fp && !index_dirty) return 0;
+    if (height >= index_count) {
+        cursor->offset = LEDGER_LOC(cursor->view->seg_count, 0);
+        return 1;
+    }
+
+    uint64_t loc = 0;
+    if (!index_loc(height, &loc)) return 0;
+    cursor->offset = (size_t)loc;
+    return 1;
+}
+
+// ---------------------------------------------------------
+// SIGILLO E ROTAZIONE DEI SEGMENTI
+// ---------------------------------------------------------
+// Apre (o crea) il segmento 'seg' come attivo: append + fd di lettura
+static int open_active_segment(int seg) {
+    char path[sizeof(ledger_path) + 16];
+    segment_path(ledger_path, seg, path, sizeof(path));
+
+    ledger_fp = fopen(path, "ab");
+    if (!ledger_fp) {
+        perror("[LEDGER] Cannot open chain log");
+        return 0;
+    }
+
+    // File nuovo (o header troncato): si riparte da un header pulito
+    fseek(ledger_fp, 0, SEEK_END);
+    if (ftell(ledger_fp) < LEDGER_HEADER_SIZE) {
+        if (ftell(ledger_fp) > 0 && ftruncate(fileno(ledger_fp), 0) != 0) {
+            perror("[LEDGER] ftruncate");
+        }
+        if (!write_file_header(ledger_fp) || fflush(ledger_fp) != 0 || fdatasync(fileno(ledger_fp)) != 0) {
+            fprintf(stderr, "[LEDGER] ❌ Impossibile scrivere l'header del ledger.\n");
+            return 0;
+        }
+    }
+    ledger_end = (uint64_t)ftell(ledger_fp);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("[LEDGER] Cannot open chain log for reading");
+        return 0;
+    }
+    if (seg >= segment_count) {
+        segment_fds = realloc(segment_fds, (size_t)(seg + 1) * sizeof(int));
+        if (!segment_fds) fatal_error("Out of memory! Failed to grow segment table.");
+        segment_count = seg + 1;
+    } else {
+        close(segment_fds[seg]);
+    }
+    segment_fds[seg] = fd;
+
+    // Blocchi già presenti nel segmento attivo (solo header dei record)
+    active_count = 0;
+    uint64_t offset = LEDGER_HEADER_SIZE;
+    uint32_t len = 0;
+    while (offset < ledger_end && read_record_len(fd, offset, &len)) {
+        active_count++;
+        offset += LEDGER_RECORD_HEADER + len;
+    }
+    return 1;
+}
+
+// Chiude il segmento attivo con il footer e apre il successivo.
+// 'last' è l'ultimo blocco scritto, 'last_offset' il suo offset nel file.
+static int seal_active_segment(const Block *last, uint64_t last_offset) {
+    int seg = segment_count - 1;
+    SegmentFooter ft = {0};
+    Block first = {0};
+
+    int ok = read_record_at(LEDGER_LOC(seg, LEDGER_HEADER_SIZE), &first) == 1;
+    ft.first_height = first.index;
+    memcpy(ft.first_hash, first.curr_hash, HASH_SIZE);
+    block_release(&first);
+    if (!ok) return 0;
+    ft.last_height = last->index;
+    memcpy(ft.last_hash, last->curr_hash, HASH_SIZE);
+    ft.records_len = ledger_end - LEDGER_HEADER_SIZE;
+    ft.last_offset = last_offset;
+
+    // CRC dei record riletti dal disco: il footer certifica ciò che è stato scritto
+    unsigned char buf[65536];
+    uint32_t crc = 0;
+    for (uint64_t pos = LEDGER_HEADER_SIZE; pos < ledger_end;) {
+        size_t want = (ledger_end - pos < sizeof(buf)) ? (size_t)(ledger_end - pos) : sizeof(buf);
+        ssize_t got = pread(segment_fds[seg], buf, want, (off_t)pos);
+        if (got <= 0) return 0;
+        crc = crc32_update(crc, buf, (size_t)got);
+        pos += (uint64_t)got;
+    }
+    ft.records_crc = crc;
+
+    unsigned char footer[LEDGER_FOOTER_SIZE];
+    encode_footer(&ft, footer);
+    if (fwrite(footer, sizeof(footer), 1, ledger_fp) != 1 || fflush(ledger_fp) != 0 ||
+        fdatasync(fileno(ledger_fp)) != 0) {
+        return 0;
+    }
+    fclose(ledger_fp);
+    ledger_fp = NULL;
+    node_printf("[LEDGER] 🔒 Segmento %d sigillato (blocchi #%d-#%d).\n", seg, ft.first_height, ft.last_height);
+
+    return open_active_segment(seg + 1);
+}
+
+// ---------------------------------------------------------
+// APERTURA LOG IN APPEND
+// ---------------------------------------------------------
+// Riapre tutti i segmenti in lettura e l'ultimo in append. Un segmento
+// pieno ma senza footer (crash durante il sigillo) viene sigillato qui.
+int ledger_open(const char *path, const char *index_path) {
+    if (ledger_fp) return 1;
+    snprintf(ledger_path, sizeof(ledger_path), "%s", path);
+
+    char seg_path[512];
+    int existing = 0;
+    segment_path(path, 0, seg_path, sizeof(seg_path));
+    while (access(seg_path, F_OK) == 0) {
+        segment_path(path, ++existing, seg_path, sizeof(seg_path));
+    }
+
+    // Segmenti precedenti all'ultimo: solo lettura
+    for (int seg = 0; seg < existing - 1; seg++) {
+        segment_path(path, seg, seg_path, sizeof(seg_path));
+        int fd = open(seg_path, O_RDONLY);
+        if (fd < 0) {
+            perror("[LEDGER] Cannot open chain segment");
+            ledger_close();
+            return 0;
+        }
+        segment_fds = realloc(segment_fds, (size_t)(seg + 1) * sizeof(int));
+        if (!segment_fds) fatal_error("Out of memory! Failed to grow segment table.");
+        segment_fds[seg] = fd;
+        segment_count = seg + 1;
+    }
+
+    int active = existing > 0 ? existing - 1 : 0;
+    if (!open_active_segment(active)) {
+        ledger_close();
+        return 0;
+    }
+
+    // L'ultimo segmento è già sigillato: si apre il successivo
+    unsigned char footer[LEDGER_FOOTER_SIZE];
+    SegmentFooter ft;
+    if (ledger_end >= LEDGER_HEADER_SIZE + LEDGER_FOOTER_SIZE &&
+        pread(segment_fds[active], footer, sizeof(footer), (off_t)(ledger_end - LEDGER_FOOTER_SIZE)) == (ssize_t)sizeof(footer) &&
+        decode_footer(footer, ledger_end, &ft)) {
+        fclose(ledger_fp);
+        ledger_fp = NULL;
+        if (!open_active_segment(active + 1)) {
+            ledger_close();
+            return 0;
+        }
+    }
+
+    snprintf(index_path_cur, sizeof(index_path_cur), "%s", index_path);
+    index_dirty = 0;
+    index_fp = fopen(index_path, "a+b");
+    if (!index_fp || !index_matches_ledger(fileno(index_fp))) {
+        if (!index_rebuild(index_path)) {
+            fprintf(stderr, "[LEDGER] ❌ Impossibile scrivere l'indice '%s'.\n", index_path);
+            ledger_close();
+            return 0;
+        }
+    }
+
+    // Segmento attivo già pieno: il sigillo era stato interrotto
+    if (active_count >= LEDGER_SEGMENT_BLOCKS) {
+        uint64_t last_loc = 0;
+        Block last = {0};
+        if (!index_loc(index_count - 1, &last_loc) ||
+            read_record_at(last_loc, &last) != 1 || !seal_active_segment(&last, LEDGER_LOC_OFF(last_loc))) {
+            fprintf(stderr, "[LEDGER] ⚠️ Impossibile sigillare il segmento attivo.\n");
+        }
+        block_release(&last);
+    }
+    return ledger_fp != NULL;
+}
+
+// ---------------------------------------------------------
+// APPEND BLOCCO (O(1) per blocco)
+// ---------------------------------------------------------
+// Scrive solo il nuovo record nel segmento attivo e forza il flush sul
+// disco: un crash dopo il return non può più far perdere il blocco.
+// L'indice viene solo flushato; se la sua scrittura fallisce viene troncato
+// all'ultima voce valida e ricostruito (vedi index_repair).
+int ledger_append_block(const Block *block) {
+    if (!ledger_fp || !block) return 0;
+
+    uint64_t offset = ledger_end;
+    if (!write_record(ledger_fp, block) || fflush(ledger_fp) != 0) {
+        fprintf(stderr, "[LEDGER] ❌ Scrittura del blocco #%d fallita.\n", block->index);
+        return 0;
+    }
+    if (fdatasync(fileno(ledger_fp)) != 0) {
+        perror("[LEDGER] fdatasync");
+        return 0;
+    }
+    ledger_end = (uint64_t)ftell(ledger_fp);
+    active_count++;
+
+    if (index_dirty || !index_append_offset(LEDGER_LOC(segment_count - 1, offset))) {
+        if (!index_dirty) fprintf(stderr, "[LEDGER] ⚠️ Indice non aggiornato per il blocco #%d.\n", block->index);
+        index_count++;
+        index_repair();
+    }
+
+    // Il blocco è già persistito: se il sigillo fallisce ci riprova ledger_open
+    if (active_count >= LEDGER_SEGMENT_BLOCKS && !seal_active_segment(block, offset)) {
+        fprintf(stderr, "[LEDGER] ⚠️ Sigillo del segmento rimandato al prossimo avvio.\n");
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------
+// CHIUSURA LOG
+// ---------------------------------------------------------
+void ledger_close(void) {
+    if (ledger_fp) fclose(ledger_fp);
+    if (index_fp) fclose(index_fp);
+    for (int i = 0; i < segment_count; i++) close(segment_fds[i]);
+    free(segment_fds);
+    ledger_fp = NULL;
+    index_fp = NULL;
+    segment_fds = NULL;
+    segment_count = 0;
+    active_count = 0;
+    index_count = 0;
+    index_dirty = 0;
+    ledger_end = 0;
+}
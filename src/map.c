@@ -5,14 +5,168 @@
 #include <stdio.h>
 #include <stdint.h>
 
-#define LOAD_FACTOR 0.75
+#if defined(__SSE2__)
+#define MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Byte di controllo: gli slot pieni hanno il bit alto spento (7 bit di hash)
+#define MAP_CTRL_EMPTY   0x80
+#define MAP_CTRL_DELETED 0xFE
+
+// Hashing moltiplicativo (costante di Fibonacci) ripiegato sui bit bassi:
+// i 7 bit bassi diventano il byte di controllo, i successivi scelgono il
+// gruppo di partenza. Basta a disperdere anche ID di post consecutivi.
+static uint64_t map_mix(unsigned long h) {
+    uint64_t x = (uint64_t)h * 0x9E3779B97F4A7C15ULL;
+    return x ^ (x >> 32);
+}
+
+static uint8_t ctrl_of(uint64_t hash) {
+    return (uint8_t)(hash & 0x7F);
+}
+
+// ---------------------------------------------------------
+// GRUPPI DI METADATI
+// ---------------------------------------------------------
+// Bitmask (bit i = slot i del gruppo) degli slot con quel byte di controllo,
+// di quelli vuoti e di quelli liberi (vuoti o cancellati: bit alto acceso).
+#ifdef MAP_SSE2
+static unsigned group_match(const uint8_t *ctrl, uint8_t byte) {
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+}
+
+static unsigned group_free(const uint8_t *ctrl) {
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+#else
+static unsigned group_match(const uint8_t *ctrl, uint8_t byte) {
+    unsigned mask = 0;
+    for (int i = 0; i < MAP_GROUP; i++) mask |= (unsigned)(ctrl[i] == byte) << i;
+    return mask;
+}
+
+static unsigned group_free(const uint8_t *ctrl) {
+    unsigned mask = 0;
+    for (int i = 0; i < MAP_GROUP; i++) mask |= (unsigned)(ctrl[i] >> 7) << i;
+    return mask;
+}
+#endif
+
+// ---------------------------------------------------------
+// TABELLE
+// ---------------------------------------------------------
+static void table_init(MapTable *t, size_t capacity) {
+    t->capacity = capacity;
+    t->used = 0;
+    t->ctrl = safe_zalloc(capacity);
+    t->slots = safe_zalloc(capacity * sizeof(MapSlot));
+    memset(t->ctrl, MAP_CTRL_EMPTY, capacity);
+}
+
+static void table_free(MapTable *t) {
+    free(t->ctrl);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+// Sondaggio quadratico sui gruppi: con un numero di gruppi potenza di 2
+// la sequenza g, g+1, g+3, g+6, ... li visita tutti
+static size_t first_group(const MapTable *t, uint64_t hash) {
+    return (size_t)(hash >> 7) & (t->capacity / MAP_GROUP - 1);
+}
+
+static long table_find(const HashMap *map, const MapTable *t, const void *key, uint64_t hash) {
+    if (t->capacity == 0) return -1;
+    size_t groups = t->capacity / MAP_GROUP;
+    size_t g = first_group(t, hash);
+    uint8_t byte = ctrl_of(hash);
+
+    for (size_t step = 1; step <= groups; step++) {
+        const uint8_t *ctrl = t->ctrl + g * MAP_GROUP;
+        for (unsigned m = group_match(ctrl, byte); m; m &= m - 1) {
+            size_t s = g * MAP_GROUP + (size_t)__builtin_ctz(m);
+            if (t->slots[s].hash == hash && map->compare(t->slots[s].key, key) == 0) return (long)s;
+        }
+        // Un gruppo con uno slot vuoto chiude la sequenza: la chiave non c'è
+        if (group_match(ctrl, MAP_CTRL_EMPTY)) return -1;
+        g = (g + step) & (groups - 1);
+    }
+    return -1;
+}
+
+// Chiave sicuramente assente: primo slot libero (vuoto o cancellato) della sequenza
+static void table_insert(MapTable *t, void *key, void *value, uint64_t hash) {
+    size_t groups = t->capacity / MAP_GROUP;
+    size_t g = first_group(t, hash);
+
+    for (size_t step = 1; ; step++) {
+        unsigned m = group_free(t->ctrl + g * MAP_GROUP);
+        if (m) {
+            size_t s = g * MAP_GROUP + (size_t)__builtin_ctz(m);
+            if (t->ctrl[s] == MAP_CTRL_EMPTY) t->used++;
+            t->ctrl[s] = ctrl_of(hash);
+            t->slots[s] = (MapSlot){ .key = key, .value = value, .hash = hash };
+            return;
+        }
+        g = (g + step) & (groups - 1);
+    }
+}
+
+// Se il gruppo ha ancora uno slot vuoto nessuna sequenza lo ha mai
+// attraversato: lo slot torna vuoto invece di diventare una tombstone
+static void table_erase(MapTable *t, size_t s) {
+    const uint8_t *group = t->ctrl + (s & ~(size_t)(MAP_GROUP - 1));
+    if (group_match(group, MAP_CTRL_EMPTY)) {
+        t->ctrl[s] = MAP_CTRL_EMPTY;
+        t->used--;
+    } else {
+        t->ctrl[s] = MAP_CTRL_DELETED;
+    }
+    t->slots[s] = (MapSlot){0};
+}
+
+// ---------------------------------------------------------
+// RESIZE INCREMENTALE
+// ---------------------------------------------------------
+// Sposta fino a 'budget' slot della tabella in svuotamento
+static void map_migrate(HashMap *map, size_t budget) {
+    MapTable *old = &map->old;
+    if (old->capacity == 0) return;
+
+    for (; budget > 0 && map->migrate_pos < old->capacity; budget--, map->migrate_pos++) {
+        size_t s = map->migrate_pos;
+        if (old->ctrl[s] & 0x80) continue;
+        MapSlot *slot = &old->slots[s];
+        table_insert(&map->table, slot->key, slot->value, slot->hash);
+        old->ctrl[s] = MAP_CTRL_DELETED;
+    }
+    if (map->migrate_pos == old->capacity) table_free(old);
+}
+
+// La tabella attiva è al limite: diventa 'old' e se ne apre una nuova.
+// Raddoppia solo se è piena di chiavi vive, altrimenti stessa capacità
+// (il resize serve a ripulire le tombstone).
+static void map_grow(HashMap *map) {
+    map_migrate(map, SIZE_MAX);   // Un resize precedente ancora in corso si chiude subito
+
+    size_t live = (size_t)map->count;
+    size_t capacity = map->table.capacity;
+    if (live * 2 >= capacity) capacity *= 2;
+
+    map->old = map->table;
+    map->migrate_pos = 0;
+    table_init(&map->table, capacity);
+}
 
 // --- CREAZIONE ---
 HashMap *map_create(int initial_size, HashFunc hash, CompareFunc compare, FreeFunc free_key, FreeFunc free_val) {
     HashMap *map = safe_zalloc(sizeof(HashMap));
-    map->size = initial_size;
+    size_t capacity = MAP_GROUP;
+    while (initial_size > 0 && capacity < (size_t)initial_size) capacity *= 2;
+    table_init(&map->table, capacity);
     map->count = 0;
-    map->buckets = safe_zalloc(map->size * sizeof(MapEntry*));
     map->hash = hash;
     map->compare = compare;
     map->free_key = free_key;
@@ -20,93 +174,86 @@ HashMap *map_create(int initial_size, HashFunc hash, CompareFunc compare, FreeFu
     return map;
 }
 
-// --- RESIZING (INTERNO) ---
-static void map_resize(HashMap *map) {
-    int old_size = map->size;
-    int new_size = old_size * 2;
-    MapEntry **new_buckets = safe_zalloc(new_size * sizeof(MapEntry*));
-
-    for (int i = 0; i < old_size; i++) {
-        MapEntry *curr = map->buckets[i];
-        while (curr) {
-            MapEntry *next = curr->next;
-            
-            // Ricalcola hash per nuova dimensione
-            unsigned long h = map->hash(curr->key) % new_size;
-            
-            // Sposta nodo (senza riallocare)
-            curr->next = new_buckets[h];
-            new_buckets[h] = curr;
-            
-            curr = next;
-        }
-    }
-    
-    free(map->buckets);
-    map->buckets = new_buckets;
-    map->size = new_size;
-    // printf("[MAP] Resized to %d buckets.\n", new_size); // Debug opzionale
-}
-
 // --- INSERIMENTO ---
 void map_put(HashMap *map, void *key, void *value) {
-    if ((double)map->count / map->size >= LOAD_FACTOR) {
-        map_resize(map);
-    }
+    uint64_t hash = map_mix(map->hash(key));
+    map_migrate(map, MAP_MIGRATE_STEP);
 
-    unsigned long h = map->hash(key) % map->size;
-    
     // Cerca se esiste già (Update)
-    MapEntry *curr = map->buckets[h];
-    while (curr) {
-        if (map->compare(curr->key, key) == 0) {
-            // Aggiorna valore
-            if (map->free_val) map->free_val(curr->value); // Libera vecchio valore
+    MapTable *tables[2] = { &map->table, &map->old };
+    for (int i = 0; i < 2; i++) {
+        long s = table_find(map, tables[i], key, hash);
+        if (s >= 0) {
+            MapSlot *slot = &tables[i]->slots[s];
+            if (map->free_val) map->free_val(slot->value); // Libera vecchio valore
             if (map->free_key) map->free_key(key);         // Libera chiave dupl. passata (non serve più)
-            curr->value = value;
+            slot->value = value;
             return;
         }
-        curr = curr->next;
     }
 
-    // Nuovo inserimento in testa
-    MapEntry *node = safe_zalloc(sizeof(MapEntry));
-    node->key = key;
-    node->value = value;
-    node->next = map->buckets[h];
-    map->buckets[h] = node;
+    if ((map->table.used + 1) * MAP_MAX_LOAD_DEN > map->table.capacity * MAP_MAX_LOAD_NUM) {
+        map_grow(map);
+    }
+    table_insert(&map->table, key, value, hash);
     map->count++;
 }
 
 // --- RECUPERO ---
 void *map_get(HashMap *map, const void *key) {
-    unsigned long h = map->hash(key) % map->size;
-    MapEntry *curr = map->buckets[h];
-    while (curr) {
-        if (map->compare(curr->key, key) == 0) return curr->value;
-        curr = curr->next;
+    uint64_t hash = map_mix(map->hash(key));
+    long s = table_find(map, &map->table, key, hash);
+    if (s >= 0) return map->table.slots[s].value;
+    s = table_find(map, &map->old, key, hash);
+    return s >= 0 ? map->old.slots[s].value : NULL;
+}
+
+// --- RIMOZIONE ---
+int map_remove(HashMap *map, const void *key) {
+    uint64_t hash = map_mix(map->hash(key));
+    map_migrate(map, MAP_MIGRATE_STEP);
+
+    MapTable *tables[2] = { &map->table, &map->old };
+    for (int i = 0; i < 2; i++) {
+        long s = table_find(map, tables[i], key, hash);
+        if (s < 0) continue;
+        MapSlot slot = tables[i]->slots[s];
+        table_erase(tables[i], (size_t)s);
+        map->count--;
+        if (map->free_key) map->free_key(slot.key);
+        if (map->free_val) map->free_val(slot.value);
+        return 1;
+    }
+    return 0;
+}
+
+// --- ITERAZIONE ---
+// L'ordine di visita dipende dagli slot: non va considerato stabile.
+static void table_foreach(MapTable *t, MapIterFunc fn, void *ctx) {
+    for (size_t s = 0; s < t->capacity; s++) {
+        if (!(t->ctrl[s] & 0x80)) fn(t->slots[s].key, t->slots[s].value, ctx);
     }
-    return NULL;
+}
+
+void map_foreach(HashMap *map, MapIterFunc fn, void *ctx) {
+    if (!map) return;
+    table_foreach(&map->table, fn, ctx);
+    table_foreach(&map->old, fn, ctx);
 }
 
 // --- CLEANUP ---
+static void free_entry(void *key, void *value, void *ctx) {
+    HashMap *map = ctx;
+    // Qui avviene la magia: chiama le funzioni di pulizia custom
+    if (map->free_key) map->free_key(key);
+    if (map->free_val) map->free_val(value);
+}
+
 void map_destroy(HashMap *map) {
     if (!map) return;
-    
-    for (int i = 0; i < map->size; i++) {
-        MapEntry *curr = map->buckets[i];
-        while (curr) {
-            MapEntry *next = curr->next;
-            
-            // Qui avviene la magia: chiama le funzioni di pulizia custom
-            if (map->free_key) map->free_key(curr->key);
-            if (map->free_val) map->free_val(curr->value);
-            
-            free(curr); // Libera il nodo della mappa
-            curr = next;
-        }
-    }
-    free(map->buckets);
+    map_foreach(map, free_entry, map);
+    table_free(&map->table);
+    table_free(&map->old);
     free(map);
 }
 
@@ -0,0 +1,345 @@
+#include "utils.h"
+#include "mempool.h"
+#include "batch.h"
+#include "user.h"
+#include "map.h"
+#include <pthread.h>
+
+typedef struct {
+    long ticket;
+    ActionType type;
+    ActionPayload data;
+    char pubkey[SIGNATURE_LEN];
+    int debit;                     // Token prenotati in pending_senders
+    SignSession *signer;           // Le azioni si firmano sulla coda del momento del mining
+} MempoolEntry;
+
+// Impegni di un mittente con azioni non ancora applicate
+typedef struct {
+    int debit;
+    int registrations;
+    int actions;                   // A zero l'entry viene rimossa
+} PendingSender;
+
+typedef struct {
+    long ticket;
+    ActionType type;
+    TicketStatus status;
+    int block_index;
+} TicketRecord;
+
+static pthread_mutex_t chain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;   // Nuove azioni o stop
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;   // Ticket risolti
+
+// Protetti da pool_mutex
+static MempoolEntry queue[MEMPOOL_CAPACITY];
+static int queue_head = 0;
+static int queue_count = 0;
+static int in_flight = 0;             // Prelevate dal miner, non ancora risolte
+static int stopping = 0;
+static long next_ticket = 1;
+static long resolved_upto = 0;        // I ticket si risolvono in ordine (FIFO)
+static long notified_upto = 0;
+static TicketRecord history[MEMPOOL_TICKET_HISTORY];
+
+// Protetti da chain_mutex (scritto solo dal miner)
+static Block *chain_tip = NULL;
+static HashMap *pending_senders = NULL;   // pubkey -> PendingSender
+static HashMap *pending_finalize = NULL;  // post_id -> numero di finalizzazioni in sospeso
+
+static pthread_t miner_tid;
+static int miner_running = 0;
+
+void chain_lock(void) { pthread_mutex_lock(&chain_mutex); }
+void chain_unlock(void) { pthread_mutex_unlock(&chain_mutex); }
+
+Block *mempool_tip(void) {
+    return chain_tip;
+}
+
+static const char *action_name(ActionType type) {
+    switch (type) {
+        case ACT_REGISTER_USER: return "registrazione";
+        case ACT_POST_CONTENT: return "post";
+        case ACT_POST_COMMENT: return "commento";
+        case ACT_VOTE_COMMIT: return "voto";
+        case ACT_VOTE_REVEAL: return "reveal";
+        case ACT_FOLLOW_USER: return "follow";
+        case ACT_POST_FINALIZE: return "finalizzazione";
+        case ACT_TRANSFER: return "trasferimento";
+        default: return "azione";
+    }
+}
+
+// ---------------------------------------------------------
+// IMPEGNI IN SOSPESO
+// ---------------------------------------------------------
+// Prenotati da mempool_submit e rilasciati dal miner nella stessa sezione
+// sotto chain_lock in cui il blocco viene applicato (o scartato): chi tiene
+// il lock vede sempre saldo e impegni coerenti tra loro.
+static void pending_add(const MempoolEntry *e, int sign) {
+    PendingSender *s = map_get(pending_senders, e->pubkey);
+    if (!s) {
+        s = safe_zalloc(sizeof(PendingSender));
+        map_put(pending_senders, strdup(e->pubkey), s);
+    }
+    s->debit += sign * e->debit;
+    s->actions += sign;
+    if (e->type == ACT_REGISTER_USER) s->registrations += sign;
+    if (s->actions == 0) map_remove(pending_senders, e->pubkey);
+
+    if (e->type == ACT_POST_FINALIZE) {
+        void *key = (void *)(uintptr_t)e->data.finalize.target_post_id;
+        uintptr_t n = (uintptr_t)map_get(pending_finalize, key) + sign;
+        if (n) map_put(pending_finalize, key, (void *)n);
+        else map_remove(pending_finalize, key);
+    }
+}
+
+int mempool_pending_debit(const char *pubkey_hex) {
+    PendingSender *s = pending_senders ? map_get(pending_senders, pubkey_hex) : NULL;
+    return s ? s->debit : 0;
+}
+
+int mempool_registration_pending(const char *pubkey_hex) {
+    PendingSender *s = pending_senders ? map_get(pending_senders, pubkey_hex) : NULL;
+    return s && s->registrations > 0;
+}
+
+int mempool_finalize_pending(int post_id) {
+    return pending_finalize && map_get(pending_finalize, (void *)(uintptr_t)post_id) != NULL;
+}
+
+// ---------------------------------------------------------
+// PRELIEVO DI UN BATCH
+// ---------------------------------------------------------
+// In ordine di arrivo, fino a MAX_BLOCK_ACTIONS. Ci si ferma prima di un
+// secondo post (l'ID è l'altezza del blocco) o di un'azione identica a una
+// già presa (es. follow + unfollow): foglie uguali renderebbero il batch
+// invalido, la seconda va nel blocco successivo.
+static int take_batch(MempoolEntry *out) {
+    int n = 0, posts = 0;
+    while (n < queue_count && n < MAX_BLOCK_ACTIONS) {
+        const MempoolEntry *e = &queue[(queue_head + n) % MEMPOOL_CAPACITY];
+        if (e->type == ACT_POST_CONTENT && posts == 1) break;
+
+        int duplicate = 0;
+        for (int i = 0; i < n && !duplicate; i++) {
+            duplicate = out[i].type == e->type && strcmp(out[i].pubkey, e->pubkey) == 0
+                     && memcmp(&out[i].data, &e->data, sizeof(ActionPayload)) == 0;
+        }
+        if (duplicate) break;
+
+        if (e->type == ACT_POST_CONTENT) posts++;
+        out[n++] = *e;
+    }
+    queue_head = (queue_head + n) % MEMPOOL_CAPACITY;
+    queue_count -= n;
+    return n;
+}
+
+// ---------------------------------------------------------
+// MINING DI UN BATCH
+// ---------------------------------------------------------
+// Solo questo thread estende la chain: la coda letta all'inizio è ancora la
+// coda al momento del commit. Ritorna l'altezza del blocco, -1 se fallisce.
+static int mine_entries(const MempoolEntry *batch, int n) {
+    Block *prev = chain_tip;
+    Block *b;
+
+    if (n == 1) {
+        b = block_new_action(prev, batch[0].type, &batch[0].data, batch[0].pubkey);
+    } else {
+        static Action actions[MAX_BLOCK_ACTIONS]; // Solo il thread del miner la usa
+        for (int i = 0; i < n; i++) {
+            memset(&actions[i], 0, sizeof(Action));
+            actions[i].type = batch[i].type;
+            snprintf(actions[i].sender_pubkey, sizeof(actions[i].sender_pubkey), "%s", batch[i].pubkey);
+            actions[i].data = batch[i].data;
+            action_sign(&actions[i], prev->curr_hash, batch[i].signer);
+        }
+        // L'header lo firma il mittente della prima azione
+        b = block_new_batch(prev, actions, n, batch[0].pubkey);
+    }
+    chain_lock();
+    int ok = b && block_prepare(prev, b);
+    chain_unlock();
+
+    ok = ok && block_solve(b, batch[0].signer);
+
+    // Applicate o scartate, le azioni smettono di impegnare i mittenti
+    chain_lock();
+    ok = ok && block_commit(prev, b);
+    if (ok) {
+        state_apply_block(b);
+        chain_tip = b;
+    }
+    for (int i = 0; i < n; i++) pending_add(&batch[i], -1);
+    chain_unlock();
+
+    if (!ok) {
+        block_free(b);
+        return -1;
+    }
+    return b->index;
+}
+
+static void *miner_thread(void *arg) {
+    (void)arg;
+    static MempoolEntry batch[MAX_BLOCK_ACTIONS];
+    node_printf_defer(); // Log di mining e stato escono con le notifiche, non sopra il prompt
+
+    pthread_mutex_lock(&pool_mutex);
+    while (1) {
+        while (queue_count == 0 && !stopping) pthread_cond_wait(&pool_work, &pool_mutex);
+        if (queue_count == 0) break; // Stop richiesto e coda vuota
+
+        int n = take_batch(batch);
+        in_flight = n;
+        pthread_mutex_unlock(&pool_mutex);
+
+        int height = mine_entries(batch, n);
+
+        pthread_mutex_lock(&pool_mutex);
+        for (int i = 0; i < n; i++) {
+            history[batch[i].ticket % MEMPOOL_TICKET_HISTORY] = (TicketRecord){
+                .ticket = batch[i].ticket,
+                .type = batch[i].type,
+                .status = height >= 0 ? TICKET_INCLUDED : TICKET_DROPPED,
+                .block_index = height
+            };
+        }
+        resolved_upto = batch[n - 1].ticket;
+        in_flight = 0;
+        pthread_cond_broadcast(&pool_done);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return NULL;
+}
+
+// ---------------------------------------------------------
+// AVVIO / ARRESTO
+// ---------------------------------------------------------
+void mempool_start(Block *tip) {
+    chain_tip = tip;
+    pending_senders = map_create(64, hash_str, cmp_str, free, free);
+    pending_finalize = map_create(16, hash_int_direct, cmp_int_direct, NULL, NULL);
+    stopping = 0;
+    if (pthread_create(&miner_tid, NULL, miner_thread, NULL) != 0) {
+        fatal_error("Impossibile avviare il thread del miner.");
+    }
+    miner_running = 1;
+}
+
+void mempool_stop(void) {
+    if (!miner_running) return;
+    pthread_mutex_lock(&pool_mutex);
+    if (queue_count + in_flight > 0) printf("[MEMPOOL] ⏳ Mining delle %d azioni in sospeso...\n", queue_count + in_flight);
+    stopping = 1;
+    pthread_cond_signal(&pool_work);
+    pthread_mutex_unlock(&pool_mutex);
+
+    pthread_join(miner_tid, NULL);
+    miner_running = 0;
+    map_destroy(pending_senders);
+    map_destroy(pending_finalize);
+    pending_senders = pending_finalize = NULL;
+    mempool_print_notifications();
+}
+
+// ---------------------------------------------------------
+// TICKET
+// ---------------------------------------------------------
+long mempool_submit(ActionType type, const void *payload, const char *pubkey_hex, SignSession *signer, int debit) {
+    pthread_mutex_lock(&pool_mutex);
+    if (queue_count == MEMPOOL_CAPACITY) {
+        pthread_mutex_unlock(&pool_mutex);
+        printf("[MEMPOOL] ❌ Mempool pieno (%d azioni): riprova tra poco.\n", MEMPOOL_CAPACITY);
+        return -1;
+    }
+    MempoolEntry *e = &queue[(queue_head + queue_count) % MEMPOOL_CAPACITY];
+    memset(e, 0, sizeof(MempoolEntry));
+    e->ticket = next_ticket++;
+    e->type = type;
+    action_set_payload(&e->data, type, payload);
+    snprintf(e->pubkey, sizeof(e->pubkey), "%s", pubkey_hex);
+    e->debit = debit;
+    e->signer = signer;
+    queue_count++;
+    pending_add(e, +1);
+
+    long ticket = e->ticket;
+    pthread_cond_signal(&pool_work);
+    pthread_mutex_unlock(&pool_mutex);
+
+    printf("[MEMPOOL] 🎫 Ticket #%ld: %s in coda.\n", ticket, action_name(type));
+    return ticket;
+}
+
+// Da chiamare con pool_mutex preso
+static TicketStatus ticket_status(long ticket, int *block_index) {
+    if (ticket <= 0 || ticket >= next_ticket) return TICKET_UNKNOWN;
+    if (ticket > resolved_upto) return TICKET_PENDING;
+
+    const TicketRecord *r = &history[ticket % MEMPOOL_TICKET_HISTORY];
+    if (r->ticket != ticket) return TICKET_UNKNOWN;
+    if (block_index) *block_index = r->block_index;
+    return r->status;
+}
+
+TicketStatus mempool_ticket(long ticket, int *block_index) {
+    pthread_mutex_lock(&pool_mutex);
+    TicketStatus s = ticket_status(ticket, block_index);
+    pthread_mutex_unlock(&pool_mutex);
+    return s;
+}
+
+TicketStatus mempool_wait(long ticket, int *block_index) {
+    pthread_mutex_lock(&pool_mutex);
+    TicketStatus s;
+    while ((s = ticket_status(ticket, block_index)) == TICKET_PENDING && miner_running) {
+        pthread_cond_wait(&pool_done, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return s;
+}
+
+int mempool_pending(void) {
+    pthread_mutex_lock(&pool_mutex);
+    int n = queue_count + in_flight;
+    pthread_mutex_unlock(&pool_mutex);
+    return n;
+}
+
+void mempool_flush(void) {
+    pthread_mutex_lock(&pool_mutex);
+    while ((queue_count > 0 || in_flight > 0) && miner_running) pthread_cond_wait(&pool_done, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+// ---------------------------------------------------------
+// NOTIFICHE
+// ---------------------------------------------------------
+// Esiti dei ticket risolti dall'ultima chiamata (la CLI le stampa prima del menu)
+void mempool_print_notifications(void) {
+    node_printf_flush();
+    pthread_mutex_lock(&pool_mutex);
+    long from = notified_upto + 1;
+    if (resolved_upto - from >= MEMPOOL_TICKET_HISTORY) from = resolved_upto - MEMPOOL_TICKET_HISTORY + 1;
+
+    for (long t = from; t <= resolved_upto; t++) {
+        const TicketRecord *r = &history[t % MEMPOOL_TICKET_HISTORY];
+        if (r->ticket != t) continue;
+        if (r->status == TICKET_INCLUDED) {
+            printf("[MEMPOOL] ✅ Ticket #%ld (%s) incluso nel blocco #%d.", t, action_name(r->type), r->block_index);
+            if (r->type == ACT_POST_CONTENT) printf(" ID post: %d", r->block_index);
+            printf("\n");
+        } else {
+            printf("[MEMPOOL] ❌ Ticket #%ld (%s) scartato: mining fallito.\n", t, action_name(r->type));
+        }
+    }
+    notified_upto = resolved_upto;
+    pthread_mutex_unlock(&pool_mutex);
+}
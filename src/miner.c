@@ -0,0 +1,156 @@
+#include "utils.h"
+#include "miner.h"
+#include "sha256.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+int miner_threads = 0;
+
+typedef struct {
+    Sha256Ctx midstate;
+    const char *suffix;
+    size_t suffix_len;
+    int stride;                // Thread effettivamente partiti: fissato prima del via
+    int bits;
+    pthread_mutex_t gate;      // I worker attendono 'ready' prima di leggere lo stride
+    pthread_cond_t go;
+    int ready;
+    atomic_int found;          // 1 appena un worker trova un hash valido
+    int nonce;                 // Scritti solo dal vincitore (CAS su 'found')
+    uint8_t hash[HASH_SIZE];
+} MinerJob;
+
+typedef struct {
+    MinerJob *job;
+    int start;
+    unsigned long hashes;
+    double seconds;
+} MinerWorker;
+
+static double elapsed_since(const struct timespec *t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+// ---------------------------------------------------------
+// WORKER
+// ---------------------------------------------------------
+static void *miner_worker(void *arg) {
+    MinerWorker *w = arg;
+    MinerJob *job = w->job;
+    struct timespec t0;
+
+    pthread_mutex_lock(&job->gate);
+    while (!job->ready) pthread_cond_wait(&job->go, &job->gate);
+    pthread_mutex_unlock(&job->gate);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // Un buffer per corsia: le cifre del nonce vengono scritte allineate a
+    // destra subito prima del suffisso, che si copia una volta sola.
+    const size_t digits_cap = 12;
+    uint8_t *tails = safe_zalloc(SHA256_MAX_LANES * (digits_cap + job->suffix_len));
+    const uint8_t *msgs[SHA256_MAX_LANES];
+    size_t lens[SHA256_MAX_LANES];
+    uint8_t digests[SHA256_MAX_LANES][HASH_SIZE];
+    for (int l = 0; l < SHA256_MAX_LANES; l++) {
+        memcpy(tails + l * (digits_cap + job->suffix_len) + digits_cap, job->suffix, job->suffix_len);
+    }
+
+    const long group = (long)job->stride * SHA256_MAX_LANES;
+    for (long base = w->start; base <= INT_MAX; base += group) {
+        if ((w->hashes % MINER_STOP_CHECK) == 0 && atomic_load_explicit(&job->found, memory_order_relaxed)) break;
+
+        // La corsia l prova il nonce base + l * stride
+        int n = 0;
+        for (long nonce = base; n < SHA256_MAX_LANES && nonce <= INT_MAX; nonce += job->stride, n++) {
+            uint8_t *end = tails + n * (digits_cap + job->suffix_len) + digits_cap;
+            uint8_t *p = end;
+            unsigned long v = (unsigned long)nonce;
+            do { *--p = (uint8_t)('0' + v % 10); v /= 10; } while (v);
+            msgs[n] = p;
+            lens[n] = (size_t)(end - p) + job->suffix_len;
+        }
+        sha256_many(&job->midstate, msgs, lens, n, digests);
+        w->hashes += (unsigned long)n;
+
+        int hit = 0;
+        for (int l = 0; l < n && !hit; l++) {
+            if (!pow_hash_meets(digests[l], job->bits)) continue;
+            int expected = 0;
+            hit = 1;
+            if (atomic_compare_exchange_strong(&job->found, &expected, 1)) {
+                job->nonce = (int)(base + (long)l * job->stride);
+                memcpy(job->hash, digests[l], HASH_SIZE);
+            }
+        }
+        if (hit) break;
+    }
+    free(tails);
+    w->seconds = elapsed_since(&t0);
+    return NULL;
+}
+
+static int thread_count(void) {
+    long n = miner_threads > 0 ? miner_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > MINER_MAX_THREADS) n = MINER_MAX_THREADS;
+    return n < 1 ? 1 : (int)n;
+}
+
+// ---------------------------------------------------------
+// RICERCA DEL NONCE
+// ---------------------------------------------------------
+int miner_search(const char *prefix, size_t prefix_len, const char *suffix, size_t suffix_len,
+                 int bits, int *nonce_out, uint8_t *hash_out) {
+    MinerJob job = { .suffix = suffix, .suffix_len = suffix_len, .bits = bits };
+    atomic_init(&job.found, 0);
+    pthread_mutex_init(&job.gate, NULL);
+    pthread_cond_init(&job.go, NULL);
+    sha256_init(&job.midstate);
+    sha256_update(&job.midstate, prefix, prefix_len);
+
+    MinerWorker workers[MINER_MAX_THREADS];
+    pthread_t tids[MINER_MAX_THREADS];
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // Il thread 0 è il chiamante. Si parte solo quando si sa quanti thread
+    // sono davvero partiti: lo stride è quel numero e nessuna classe di
+    // nonce resta scoperta se un pthread_create fallisce.
+    int wanted = thread_count(), running = 1;
+    workers[0] = (MinerWorker){ .job = &job, .start = 0 };
+    for (int t = 1; t < wanted; t++) {
+        workers[running] = (MinerWorker){ .job = &job, .start = running };
+        if (pthread_create(&tids[running], NULL, miner_worker, &workers[running]) == 0) running++;
+    }
+    pthread_mutex_lock(&job.gate);
+    job.stride = running;
+    job.ready = 1;
+    pthread_cond_broadcast(&job.go);
+    pthread_mutex_unlock(&job.gate);
+
+    miner_worker(&workers[0]);
+    for (int t = 1; t < running; t++) pthread_join(tids[t], NULL);
+    pthread_cond_destroy(&job.go);
+    pthread_mutex_destroy(&job.gate);
+
+    // Statistiche: hash rate totale e per thread
+    unsigned long total = 0;
+    for (int t = 0; t < job.stride; t++) total += workers[t].hashes;
+    double secs = elapsed_since(&t0);
+    node_printf("[MINER] %lu hash in %.3fs (%.0f kH/s, %d thread, sha256 %s)", total, secs,
+                secs > 0 ? (double)total / secs / 1000.0 : 0.0, job.stride, sha256_kernel());
+    for (int t = 0; t < job.stride; t++) {
+        node_printf(" | T%d %.0f kH/s", t,
+                    workers[t].seconds > 0 ? (double)workers[t].hashes / workers[t].seconds / 1000.0 : 0.0);
+    }
+    node_printf("\n");
+
+    if (!atomic_load(&job.found)) return 0;
+    *nonce_out = job.nonce;
+    memcpy(hash_out, job.hash, HASH_SIZE);
+    return 1;
+}
@@ -0,0 +1,252 @@
+#include "utils.h"
+#include "mmr.h"
+#include "wwyl_crypto.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    uint8_t hash[HASH_SIZE];
+    int height;
+} MmrPeak;
+
+static FILE *mmr_fp = NULL;
+static long leaf_count = 0;
+static long node_count = 0;
+static MmrPeak peaks[MMR_MAX_HEIGHT];
+static int peak_count = 0;
+
+// Nodi di un MMR con n foglie: ogni montagna di 2^h foglie ne ha 2^(h+1) - 1
+static long mmr_size(long leaves) {
+    return 2 * leaves - __builtin_popcountl((unsigned long)leaves);
+}
+
+static void hash_pair(const uint8_t *left, const uint8_t *right, uint8_t *out) {
+    uint8_t pair[2 * HASH_SIZE];
+    memcpy(pair, left, HASH_SIZE);
+    memcpy(pair + HASH_SIZE, right, HASH_SIZE);
+    sha256_raw(pair, sizeof(pair), out);
+}
+
+static int read_node(long pos, uint8_t *out) {
+    off_t at = MMR_HEADER_SIZE + (off_t)pos * HASH_SIZE;
+    return pread(fileno(mmr_fp), out, HASH_SIZE, at) == HASH_SIZE;
+}
+
+static int write_node(const uint8_t *hash) {
+    if (fwrite(hash, HASH_SIZE, 1, mmr_fp) != 1) return 0;
+    node_count++;
+    return 1;
+}
+
+// ---------------------------------------------------------
+// APPEND DI UNA FOGLIA
+// ---------------------------------------------------------
+// La foglia nuova si fonde con i picchi della stessa altezza finché può:
+// i genitori vengono scritti subito dopo, quindi il file resta in post-ordine.
+static int append_leaf(const uint8_t *block_hash) {
+    uint8_t cur[HASH_SIZE];
+    int height = 0;
+
+    memcpy(cur, block_hash, HASH_SIZE);
+    if (!write_node(cur)) return 0;
+    while (peak_count > 0 && peaks[peak_count - 1].height == height) {
+        hash_pair(peaks[peak_count - 1].hash, cur, cur);
+        peak_count--;
+        if (!write_node(cur)) return 0;
+        height++;
+    }
+    memcpy(peaks[peak_count].hash, cur, HASH_SIZE);
+    peaks[peak_count].height = height;
+    peak_count++;
+    leaf_count++;
+    return 1;
+}
+
+int mmr_append(const uint8_t *block_hash) {
+    if (!mmr_fp) return 0;
+    if (!append_leaf(block_hash) || fflush(mmr_fp) != 0) {
+        // Stato in RAM non più allineato al file: ci pensa il prossimo avvio
+        fclose(mmr_fp);
+        mmr_fp = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// I picchi sono le radici delle montagne: una per ogni bit a 1 di leaf_count,
+// dalla più alta (a sinistra) alla più bassa.
+static int load_peaks(void) {
+    long start = 0;
+    peak_count = 0;
+    for (int h = MMR_MAX_HEIGHT - 1; h >= 0; h--) {
+        if (!(leaf_count & (1L << h))) continue;
+        long nodes = (1L << (h + 1)) - 1;
+        if (!read_node(start + nodes - 1, peaks[peak_count].hash)) return 0;
+        peaks[peak_count++].height = h;
+        start += nodes;
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------
+// APERTURA E RICOSTRUZIONE
+// ---------------------------------------------------------
+// Il file combacia se ha esattamente i nodi di view->count foglie e l'ultima
+// foglia è l'hash della coda della chain.
+static int mmr_matches_ledger(const LedgerView *view) {
+    struct stat st;
+    long leaves = view ? view->count : 0;
+    unsigned char hdr[MMR_HEADER_SIZE];
+
+    if (fstat(fileno(mmr_fp), &st) != 0) return 0;
+    if (st.st_size != MMR_HEADER_SIZE + (off_t)mmr_size(leaves) * HASH_SIZE) return 0;
+    if (pread(fileno(mmr_fp), hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || memcmp(hdr, MMR_MAGIC, 4) != 0) return 0;
+    if (leaves > 0) {
+        Block tip = {0};
+        uint8_t last_leaf[HASH_SIZE];
+        int ok = ledger_read_block_at(view, view->last_offset, &tip) && read_node(mmr_size(leaves - 1), last_leaf)
+                 && memcmp(last_leaf, tip.curr_hash, HASH_SIZE) == 0;
+        block_release(&tip);
+        if (!ok) return 0;
+    }
+    leaf_count = leaves;
+    node_count = mmr_size(leaves);
+    return 1;
+}
+
+static int mmr_rebuild(const char *path, const LedgerView *view) {
+    unsigned char hdr[MMR_HEADER_SIZE] = {0};
+    Block b = {0};
+    LedgerCursor cursor;
+
+    if (mmr_fp) fclose(mmr_fp);
+    mmr_fp = fopen(path, "w+b");
+    if (!mmr_fp) return 0;
+    leaf_count = node_count = 0;
+    peak_count = 0;
+
+    memcpy(hdr, MMR_MAGIC, 4);
+    hdr[4] = MMR_VERSION;
+    if (fwrite(hdr, sizeof(hdr), 1, mmr_fp) != 1) return 0;
+    if (view) {
+        ledger_cursor_init(&cursor, view);
+        int ok = 1;
+        while (ok && ledger_cursor_next(&cursor, &b)) ok = append_leaf(b.curr_hash);
+        block_release(&b);
+        if (!ok) return 0;
+        printf("[MMR] Accumulatore ricostruito (%ld blocchi, %ld nodi).\n", leaf_count, node_count);
+    }
+    return fflush(mmr_fp) == 0;
+}
+
+int mmr_open(const char *path, const LedgerView *view) {
+    mmr_fp = fopen(path, "a+b");
+    if (!mmr_fp || !mmr_matches_ledger(view) || !load_peaks()) {
+        if (!mmr_rebuild(path, view)) {
+            fprintf(stderr, "[MMR] ❌ Impossibile scrivere l'accumulatore '%s'.\n", path);
+            mmr_close();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void mmr_close(void) {
+    if (mmr_fp) fclose(mmr_fp);
+    mmr_fp = NULL;
+    leaf_count = node_count = 0;
+    peak_count = 0;
+}
+
+long mmr_leaf_count(void) {
+    return leaf_count;
+}
+
+// Bagging da destra: root = H(p0 || H(p1 || ... H(p_{k-2} || p_{k-1})))
+static void bag_peaks(const uint8_t (*peak_hashes)[HASH_SIZE], int count, uint8_t *root) {
+    memcpy(root, peak_hashes[count - 1], HASH_SIZE);
+    for (int i = count - 2; i >= 0; i--) hash_pair(peak_hashes[i], root, root);
+}
+
+int mmr_root(uint8_t *root) {
+    uint8_t hashes[MMR_MAX_HEIGHT][HASH_SIZE];
+    if (!mmr_fp || peak_count == 0) return 0;
+    for (int i = 0; i < peak_count; i++) memcpy(hashes[i], peaks[i].hash, HASH_SIZE);
+    bag_peaks((const uint8_t (*)[HASH_SIZE])hashes, peak_count, root);
+    return 1;
+}
+
+// ---------------------------------------------------------
+// PROVA DI INCLUSIONE
+// ---------------------------------------------------------
+// Si scende dal picco della montagna che contiene la foglia: in un
+// sottoalbero di altezza h che parte da 'start', la radice sinistra sta in
+// start + 2^h - 2 e la destra in start + 2^(h+1) - 3.
+int mmr_prove(long leaf_index, MmrProof *proof) {
+    if (!mmr_fp || leaf_index < 0 || leaf_index >= leaf_count) return 0;
+
+    memset(proof, 0, sizeof(MmrProof));
+    proof->leaf_index = leaf_index;
+    proof->leaf_count = leaf_count;
+    proof->peak_count = peak_count;
+    for (int i = 0; i < peak_count; i++) memcpy(proof->peaks[i], peaks[i].hash, HASH_SIZE);
+
+    long start = 0, first_leaf = 0;
+    for (int i = 0; i < peak_count; i++) {
+        int h = peaks[i].height;
+        long leaves = 1L << h;
+        if (leaf_index >= first_leaf + leaves) {
+            start += 2 * leaves - 1;
+            first_leaf += leaves;
+            continue;
+        }
+        // Fratelli raccolti dall'alto, poi rigirati (dalla foglia al picco)
+        long j = leaf_index - first_leaf;
+        for (int level = h; level > 0; level--) {
+            long half = 1L << (level - 1);
+            long left_root = start + 2 * half - 2;
+            long right_root = start + 4 * half - 3;
+            uint8_t *sibling = proof->path[level - 1];
+            if (j < half) {
+                if (!read_node(right_root, sibling)) return 0;
+            } else {
+                if (!read_node(left_root, sibling)) return 0;
+                start = left_root + 1;
+                j -= half;
+            }
+        }
+        proof->path_len = h;
+        return 1;
+    }
+    return 0;
+}
+
+int mmr_verify(const uint8_t *block_hash, const MmrProof *proof, const uint8_t *root) {
+    long n = proof->leaf_count;
+    if (n <= 0 || n >= (1L << MMR_MAX_HEIGHT) || proof->leaf_index < 0 || proof->leaf_index >= n) return 0;
+    if (proof->peak_count != __builtin_popcountl((unsigned long)n)) return 0;
+
+    long first_leaf = 0;
+    int peak = 0;
+    for (int h = MMR_MAX_HEIGHT - 1; h >= 0; h--) {
+        if (!(n & (1L << h))) continue;
+        if (proof->leaf_index < first_leaf + (1L << h)) {
+            if (proof->path_len != h) return 0;
+
+            // Il bit l dell'indice locale dice da che lato sta il fratello
+            uint8_t cur[HASH_SIZE], bagged[HASH_SIZE];
+            long j = proof->leaf_index - first_leaf;
+            memcpy(cur, block_hash, HASH_SIZE);
+            for (int level = 0; level < h; level++) {
+                if ((j >> level) & 1) hash_pair(proof->path[level], cur, cur);
+                else hash_pair(cur, proof->path[level], cur);
+            }
+            if (memcmp(cur, proof->peaks[peak], HASH_SIZE) != 0) return 0;
+            bag_peaks((const uint8_t (*)[HASH_SIZE])proof->peaks, proof->peak_count, bagged);
+            return memcmp(bagged, root, HASH_SIZE) == 0;
+        }
+        first_leaf += 1L << h;
+        peak++;
+    }
+    return 0;
+}
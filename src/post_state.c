@@ -7,37 +7,12 @@
 
 HashMap *global_post_index = NULL;
 
-// ---------------------------------------------------------
-// FREE WRAPPER CUSTOM PER POSTSTATE
-// ---------------------------------------------------------
-void free_post_state_wrapper(void *data) {
-    PostState *p = (PostState*)data;
-    if (!p) return;
-
-    // 1. Libera la lista dei Commit
-    CommitNode *c = p->commits;
-    while (c) {
-        CommitNode *temp = c;
-        c = c->next;
-        free(temp);
-    }
-
-    // 2. Libera la lista dei Reveal
-    RevealNode *r = p->reveals;
-    while (r) {
-        RevealNode *temp = r;
-        r = r->next;
-        free(temp);
-    }
+// PostState e nodi di commit/reveal/commenti vivono tutti nell'arena:
+// niente free uno per uno, post_index_cleanup rilascia tutto in blocco.
+static Arena post_arena;
 
-    // 3. Libera la lista dei Commenti
-    CommentNode *k = p->comments;
-    while (k) {
-        CommentNode *temp = k;
-        k = k->next;
-        free(temp);
-    }
-    free(p);
+void *post_state_alloc(size_t size) {
+    return arena_alloc(&post_arena, size);
 }
 
 // ---------------------------------------------------------
@@ -46,28 +21,28 @@ void free_post_state_wrapper(void *data) {
 void post_index_init() {
     // Configurazione Mappa:
     // Key: (void*)int (ID Post) -> Nessuna free necessaria (NULL)
-    // Val: PostState* -> Usiamo il wrapper custom per pulire le liste!
-    global_post_index = map_create(INITIAL_POST_MAP_SIZE, hash_int_direct, cmp_int_direct, NULL, free_post_state_wrapper);
+    // Val: PostState* -> Nell'arena, liberato con lei (NULL)
+    global_post_index = map_create(INITIAL_POST_MAP_SIZE, hash_int_direct, cmp_int_direct, NULL, NULL);
 }
 
 // ---------------------------------------------------------
 // PULIZIA INDICE POST
 // ---------------------------------------------------------
 void post_index_cleanup() {
-    // Ora basta chiamare map_destroy e lei chiamerà free_post_state_wrapper per ogni elemento
     if (global_post_index) {
         map_destroy(global_post_index);
         global_post_index = NULL;
     }
+    arena_free(&post_arena);
 }
 
 // ---------------------------------------------------------
 // API INDICE POST
 // ---------------------------------------------------------
-void post_index_add(int post_id, const char *author) {
-    PostState *p = safe_zalloc(sizeof(PostState));
+void post_index_add(int post_id, UserId author) {
+    PostState *p = post_state_alloc(sizeof(PostState));
     p->post_id = post_id;
-    snprintf(p->author_pubkey, SIGNATURE_LEN, "%s", author);
+    p->author_id = author;
     p->is_open = 1;
     p->created_at = time(NULL);
     
@@ -93,28 +68,28 @@ int post_index_exists(int post_id) {
 // ---------------------------------------------------------
 // RECUPERA AUTORE POST
 // ---------------------------------------------------------
-char *post_index_author(int post_id) {
+UserId post_index_author(int post_id) {
     PostState *p = post_index_get(post_id);
-    return p ? p->author_pubkey : NULL;
+    return p ? p->author_id : USER_ID_NONE;
 }
 
 // ---------------------------------------------------------
 // API VOTI
 // ---------------------------------------------------------
-void post_register_commit(int post_id, const char *voter, const char *hash) {
+void post_register_commit(int post_id, UserId voter, const uint8_t *hash) {
     PostState *p = post_index_get(post_id);
     if (!p) return;
 
     // Check duplicati
     CommitNode *curr = p->commits;
     while(curr) {
-        if (strcmp(curr->voter_pubkey, voter) == 0) return; 
+        if (curr->voter_id == voter) return; 
         curr = curr->next;
     }
 
-    CommitNode *node = safe_zalloc(sizeof(CommitNode));
-    snprintf(node->voter_pubkey, SIGNATURE_LEN, "%s", voter);
-    snprintf(node->vote_hash, HASH_LEN, "%s", hash);
+    CommitNode *node = post_state_alloc(sizeof(CommitNode));
+    node->voter_id = voter;
+    memcpy(node->vote_hash, hash, HASH_SIZE);
     node->next = p->commits;
     p->commits = node;
 }
@@ -122,14 +97,14 @@ void post_register_commit(int post_id, const char *voter, const char *hash) {
 // ---------------------------------------------------------
 // VERIFICA COMMIT
 // ---------------------------------------------------------
-int post_verify_commit(int post_id, const char *voter, const char *calculated_hash) {
+int post_verify_commit(int post_id, UserId voter, const uint8_t *calculated_hash) {
     PostState *p = post_index_get(post_id);
     if (!p) return 0;
 
     CommitNode *curr = p->commits;
     while(curr) {
-        if (strcmp(curr->voter_pubkey, voter) == 0) {
-            return (strncmp(curr->vote_hash, calculated_hash, HASH_LEN) == 0);
+        if (curr->voter_id == voter) {
+            return (memcmp(curr->vote_hash, calculated_hash, HASH_SIZE) == 0);
         }
         curr = curr->next;
     }
@@ -139,15 +114,15 @@ int post_verify_commit(int post_id, const char *voter, const char *calculated_ha
 // ---------------------------------------------------------
 // REGISTRA REVEAL
 // ---------------------------------------------------------
-void post_register_reveal(int post_id, const char *voter, int vote_val) {
+void post_register_reveal(int post_id, UserId voter, int vote_val) {
     PostState *p = post_index_get(post_id);
     if (!p || !p->is_open) return;
 
     if (vote_val == 1) p->likes++;
     else if (vote_val == -1) p->dislikes++;
 
-    RevealNode *node = safe_zalloc(sizeof(RevealNode));
-    snprintf(node->voter_pubkey, SIGNATURE_LEN, "%s", voter);
+    RevealNode *node = post_state_alloc(sizeof(RevealNode));
+    node->voter_id = voter;
     node->vote_value = vote_val;
     node->next = p->reveals;
     p->reveals = node;
@@ -156,12 +131,12 @@ void post_register_reveal(int post_id, const char *voter, int vote_val) {
 // ---------------------------------------------------------
 // REGISTRA COMMENTO
 // ---------------------------------------------------------
-void post_register_comment(int post_id, const char *author, const char *content, time_t timestamp) {
+void post_register_comment(int post_id, UserId author, const char *content, time_t timestamp) {
     PostState *p = post_index_get(post_id);
     if (!p) return;
 
-    CommentNode *node = safe_zalloc(sizeof(CommentNode));
-    snprintf(node->author_pubkey, SIGNATURE_LEN, "%s", author);
+    CommentNode *node = post_state_alloc(sizeof(CommentNode));
+    node->author_id = author;
     snprintf(node->content, MAX_CONTENT_LEN, "%s", content);
     node->timestamp = timestamp;
     
@@ -0,0 +1,417 @@
+#include "sha256.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86 1
+#include <immintrin.h>
+#endif
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// ---------------------------------------------------------
+// COMPRESSIONE DI UN BLOCCO DA 64 BYTE (SCALARE)
+// ---------------------------------------------------------
+static void compress_scalar(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) w[i] = load_be32(block + 4 * i);
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static void lanes_scalar(uint32_t *const states[], const uint8_t *const blocks[], int n) {
+    for (int i = 0; i < n; i++) compress_scalar(states[i], blocks[i]);
+}
+
+#ifdef SHA256_X86
+// ---------------------------------------------------------
+// SHA-NI: UN BLOCCO CON LE ISTRUZIONI SHA256RNDS2/MSG1/MSG2
+// ---------------------------------------------------------
+// Le istruzioni lavorano sulle coppie di registri ABEF/CDGH: lo stato viene
+// rimescolato all'ingresso e ricomposto all'uscita.
+__attribute__((target("sha,sse4.1")))
+static void compress_shani(uint32_t state[8], const uint8_t block[64]) {
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);  // CDAB
+    __m128i st1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B);  // EFGH
+    __m128i st0 = _mm_alignr_epi8(tmp, st1, 8);                                          // ABEF
+    st1 = _mm_blend_epi16(st1, tmp, 0xF0);                                               // CDGH
+    const __m128i abef = st0, cdgh = st1;
+
+    __m128i m[4];
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; g++) {
+        if (g < 4) {
+            m[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block + 16 * g)), bswap);
+        } else {
+            // W[t..t+3] da W[t-16..t-1]: msg1 (sigma0), + W[t-7..t-4], msg2 (sigma1)
+            __m128i w = _mm_sha256msg1_epu32(m[g & 3], m[(g + 1) & 3]);
+            w = _mm_add_epi32(w, _mm_alignr_epi8(m[(g + 3) & 3], m[(g + 2) & 3], 4));
+            m[g & 3] = _mm_sha256msg2_epu32(w, m[(g + 3) & 3]);
+        }
+        __m128i msg = _mm_add_epi32(m[g & 3], _mm_loadu_si128((const __m128i *)&K[4 * g]));
+        st1 = _mm_sha256rnds2_epu32(st1, st0, msg);
+        st0 = _mm_sha256rnds2_epu32(st0, st1, _mm_shuffle_epi32(msg, 0x0E));
+    }
+
+    st0 = _mm_add_epi32(st0, abef);
+    st1 = _mm_add_epi32(st1, cdgh);
+    tmp = _mm_shuffle_epi32(st0, 0x1B);                                                  // FEBA
+    st1 = _mm_shuffle_epi32(st1, 0xB1);                                                  // DCHG
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, st1, 0xF0));             // DCBA
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(st1, tmp, 8));                // HGFE
+}
+
+static void lanes_shani(uint32_t *const states[], const uint8_t *const blocks[], int n) {
+    for (int i = 0; i < n; i++) compress_shani(states[i], blocks[i]);
+}
+
+// ---------------------------------------------------------
+// MULTI-BUFFER: 4 (SSE2) O 8 (AVX2) MESSAGGI PER REGISTRO
+// ---------------------------------------------------------
+// Ogni corsia del vettore porta la stessa parola di un messaggio diverso.
+// Le corsie inutilizzate (n < larghezza) ripetono il messaggio 0 e il loro
+// risultato viene scartato.
+#define SSE_ROTR(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+#define SSE_XOR3(a, b, c) _mm_xor_si128(_mm_xor_si128((a), (b)), (c))
+
+static void lanes_sse2(uint32_t *const states[], const uint8_t *const blocks[], int n) {
+    const uint8_t *in[4];
+    uint32_t out[8][4];
+    __m128i w[64], v[8];
+
+    for (int l = 0; l < 4; l++) in[l] = blocks[l < n ? l : 0];
+    for (int t = 0; t < 16; t++) {
+        w[t] = _mm_set_epi32((int)load_be32(in[3] + 4 * t), (int)load_be32(in[2] + 4 * t),
+                             (int)load_be32(in[1] + 4 * t), (int)load_be32(in[0] + 4 * t));
+    }
+    for (int t = 16; t < 64; t++) {
+        __m128i s0 = SSE_XOR3(SSE_ROTR(w[t - 15], 7), SSE_ROTR(w[t - 15], 18), _mm_srli_epi32(w[t - 15], 3));
+        __m128i s1 = SSE_XOR3(SSE_ROTR(w[t - 2], 17), SSE_ROTR(w[t - 2], 19), _mm_srli_epi32(w[t - 2], 10));
+        w[t] = _mm_add_epi32(_mm_add_epi32(w[t - 16], s0), _mm_add_epi32(w[t - 7], s1));
+    }
+    for (int j = 0; j < 8; j++) {
+        v[j] = _mm_set_epi32((int)states[n > 3 ? 3 : 0][j], (int)states[n > 2 ? 2 : 0][j],
+                             (int)states[n > 1 ? 1 : 0][j], (int)states[0][j]);
+    }
+
+    __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    for (int t = 0; t < 64; t++) {
+        __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+        __m128i maj = SSE_XOR3(_mm_and_si128(a, b), _mm_and_si128(a, c), _mm_and_si128(b, c));
+        __m128i t1 = _mm_add_epi32(_mm_add_epi32(h, SSE_XOR3(SSE_ROTR(e, 6), SSE_ROTR(e, 11), SSE_ROTR(e, 25))),
+                                   _mm_add_epi32(_mm_add_epi32(ch, _mm_set1_epi32((int)K[t])), w[t]));
+        __m128i t2 = _mm_add_epi32(SSE_XOR3(SSE_ROTR(a, 2), SSE_ROTR(a, 13), SSE_ROTR(a, 22)), maj);
+        h = g; g = f; f = e; e = _mm_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm_add_epi32(t1, t2);
+    }
+    __m128i r[8] = { a, b, c, d, e, f, g, h };
+    for (int j = 0; j < 8; j++) _mm_storeu_si128((__m128i *)out[j], _mm_add_epi32(r[j], v[j]));
+    for (int l = 0; l < n; l++) {
+        for (int j = 0; j < 8; j++) states[l][j] = out[j][l];
+    }
+}
+
+#define AVX_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define AVX_XOR3(a, b, c) _mm256_xor_si256(_mm256_xor_si256((a), (b)), (c))
+
+__attribute__((target("avx2")))
+static void lanes_avx2(uint32_t *const states[], const uint8_t *const blocks[], int n) {
+    const uint8_t *in[8];
+    const uint32_t *st[8];
+    uint32_t out[8][8];
+    __m256i w[64], v[8];
+
+    for (int l = 0; l < 8; l++) {
+        in[l] = blocks[l < n ? l : 0];
+        st[l] = states[l < n ? l : 0];
+    }
+    for (int t = 0; t < 16; t++) {
+        w[t] = _mm256_set_epi32((int)load_be32(in[7] + 4 * t), (int)load_be32(in[6] + 4 * t),
+                                (int)load_be32(in[5] + 4 * t), (int)load_be32(in[4] + 4 * t),
+                                (int)load_be32(in[3] + 4 * t), (int)load_be32(in[2] + 4 * t),
+                                (int)load_be32(in[1] + 4 * t), (int)load_be32(in[0] + 4 * t));
+    }
+    for (int t = 16; t < 64; t++) {
+        __m256i s0 = AVX_XOR3(AVX_ROTR(w[t - 15], 7), AVX_ROTR(w[t - 15], 18), _mm256_srli_epi32(w[t - 15], 3));
+        __m256i s1 = AVX_XOR3(AVX_ROTR(w[t - 2], 17), AVX_ROTR(w[t - 2], 19), _mm256_srli_epi32(w[t - 2], 10));
+        w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+    }
+    for (int j = 0; j < 8; j++) {
+        v[j] = _mm256_set_epi32((int)st[7][j], (int)st[6][j], (int)st[5][j], (int)st[4][j],
+                                (int)st[3][j], (int)st[2][j], (int)st[1][j], (int)st[0][j]);
+    }
+
+    __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    for (int t = 0; t < 64; t++) {
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i maj = AVX_XOR3(_mm256_and_si256(a, b), _mm256_and_si256(a, c), _mm256_and_si256(b, c));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, AVX_XOR3(AVX_ROTR(e, 6), AVX_ROTR(e, 11), AVX_ROTR(e, 25))),
+                                      _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32((int)K[t])), w[t]));
+        __m256i t2 = _mm256_add_epi32(AVX_XOR3(AVX_ROTR(a, 2), AVX_ROTR(a, 13), AVX_ROTR(a, 22)), maj);
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+    __m256i r[8] = { a, b, c, d, e, f, g, h };
+    for (int j = 0; j < 8; j++) _mm256_storeu_si256((__m256i *)out[j], _mm256_add_epi32(r[j], v[j]));
+    for (int l = 0; l < n; l++) {
+        for (int j = 0; j < 8; j++) states[l][j] = out[j][l];
+    }
+}
+#endif
+
+// ---------------------------------------------------------
+// SCELTA DEL KERNEL A RUNTIME
+// ---------------------------------------------------------
+// In ordine di preferenza: il primo supportato dalla CPU vince. SHA-NI
+// elabora un blocco alla volta ma resta più veloce di 8 corsie AVX2.
+typedef struct {
+    const char *name;
+    int lanes;
+    void (*compress)(uint32_t *const states[], const uint8_t *const blocks[], int n);
+} Sha256Kernel;
+
+static const Sha256Kernel kernels[] = {
+#ifdef SHA256_X86
+    { "sha-ni", 1, lanes_shani },
+    { "avx2",   8, lanes_avx2 },
+    { "sse2",   4, lanes_sse2 },
+#endif
+    { "scalar", 1, lanes_scalar },
+};
+#define KERNEL_COUNT (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+static const Sha256Kernel *active_kernel;
+static void (*compress_one)(uint32_t state[8], const uint8_t block[64]) = compress_scalar;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static int kernel_supported(const Sha256Kernel *k) {
+#ifdef SHA256_X86
+    __builtin_cpu_init();
+    if (k->compress == lanes_shani) return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+    if (k->compress == lanes_avx2) return __builtin_cpu_supports("avx2");
+#endif
+    (void)k;
+    return 1;
+}
+
+static void kernel_activate(const Sha256Kernel *k) {
+    active_kernel = k;
+#ifdef SHA256_X86
+    // Il percorso a blocco singolo (sha256_update) usa SHA-NI se c'è
+    compress_one = kernel_supported(&kernels[0]) ? compress_shani : compress_scalar;
+    if (k->compress == lanes_scalar) compress_one = compress_scalar;
+#endif
+}
+
+// WWYL_SHA256=<nome> forza un kernel (debug, confronti)
+static void kernel_detect(void) {
+    const char *forced = getenv("WWYL_SHA256");
+    for (int i = 0; i < KERNEL_COUNT; i++) {
+        if (forced && strcmp(forced, kernels[i].name) == 0 && kernel_supported(&kernels[i])) {
+            kernel_activate(&kernels[i]);
+            return;
+        }
+    }
+    for (int i = 0; i < KERNEL_COUNT; i++) {
+        if (kernel_supported(&kernels[i])) {
+            kernel_activate(&kernels[i]);
+            return;
+        }
+    }
+}
+
+static const Sha256Kernel *kernel(void) {
+    pthread_once(&kernel_once, kernel_detect);
+    return active_kernel;
+}
+
+const char *sha256_kernel(void) {
+    return kernel()->name;
+}
+
+int sha256_set_kernel(const char *name) {
+    kernel();
+    for (int i = 0; i < KERNEL_COUNT; i++) {
+        if (strcmp(name, kernels[i].name) == 0 && kernel_supported(&kernels[i])) {
+            kernel_activate(&kernels[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void store_digest(const uint32_t state[8], uint8_t *digest) {
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)state[i];
+    }
+}
+
+void sha256_init(Sha256Ctx *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->total_len = 0;
+    ctx->buffer_len = 0;
+}
+
+void sha256_update(Sha256Ctx *ctx, const void *data, size_t len) {
+    const uint8_t *p = data;
+    kernel();
+    ctx->total_len += len;
+
+    if (ctx->buffer_len > 0) {
+        size_t take = 64 - ctx->buffer_len < len ? 64 - ctx->buffer_len : len;
+        memcpy(ctx->buffer + ctx->buffer_len, p, take);
+        ctx->buffer_len += take;
+        p += take;
+        len -= take;
+        if (ctx->buffer_len < 64) return;
+        compress_one(ctx->state, ctx->buffer);
+        ctx->buffer_len = 0;
+    }
+    for (; len >= 64; p += 64, len -= 64) compress_one(ctx->state, p);
+    memcpy(ctx->buffer, p, len);
+    ctx->buffer_len = len;
+}
+
+// Padding: 0x80, zeri, lunghezza in bit (big-endian) negli ultimi 8 byte
+void sha256_final(Sha256Ctx *ctx, uint8_t *digest) {
+    uint64_t bits = ctx->total_len * 8;
+    size_t n = ctx->buffer_len;
+
+    kernel();
+    ctx->buffer[n++] = 0x80;
+    if (n > 56) {
+        memset(ctx->buffer + n, 0, 64 - n);
+        compress_one(ctx->state, ctx->buffer);
+        n = 0;
+    }
+    memset(ctx->buffer + n, 0, 56 - n);
+    for (int i = 0; i < 8; i++) ctx->buffer[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    compress_one(ctx->state, ctx->buffer);
+    store_digest(ctx->state, digest);
+}
+
+// ---------------------------------------------------------
+// HASH DI PIÙ MESSAGGI IN PARALLELO
+// ---------------------------------------------------------
+// Ogni corsia è lo stream virtuale residuo || messaggio || padding, letto
+// un blocco da 64 byte alla volta. A ogni giro le corsie ancora attive
+// passano insieme al kernel; con messaggi della stessa lunghezza (mining)
+// finiscono tutte allo stesso giro.
+typedef struct {
+    uint32_t state[8];
+    const uint8_t *head;     // Blocco parziale del contesto di partenza
+    size_t head_len;
+    const uint8_t *msg;
+    size_t msg_len;
+    uint64_t bits;
+    size_t blocks, done;
+    uint8_t block[64];
+} Sha256Lane;
+
+static void lane_fill(Sha256Lane *l) {
+    size_t off = l->done * 64, data_len = l->head_len + l->msg_len, k = 0;
+
+    if (off < l->head_len) {
+        k = l->head_len - off < 64 ? l->head_len - off : 64;
+        memcpy(l->block, l->head + off, k);
+    }
+    if (k < 64 && off + k < data_len) {
+        size_t from = off + k - l->head_len;
+        size_t n = l->msg_len - from < 64 - k ? l->msg_len - from : 64 - k;
+        memcpy(l->block + k, l->msg + from, n);
+        k += n;
+    }
+    memset(l->block + k, 0, 64 - k);
+    if (data_len >= off && data_len < off + 64) l->block[data_len - off] = 0x80;
+    if (l->done + 1 == l->blocks) {
+        for (int i = 0; i < 8; i++) l->block[56 + i] = (uint8_t)(l->bits >> (56 - 8 * i));
+    }
+}
+
+void sha256_many(const Sha256Ctx *start, const uint8_t *const msgs[], const size_t lens[], int n,
+                 uint8_t digests[][32]) {
+    const Sha256Kernel *k = kernel();
+    Sha256Ctx iv;
+    if (!start) {
+        sha256_init(&iv);
+        start = &iv;
+    }
+
+    for (int base = 0; base < n; base += SHA256_MAX_LANES) {
+        Sha256Lane lanes[SHA256_MAX_LANES];
+        int count = n - base < SHA256_MAX_LANES ? n - base : SHA256_MAX_LANES;
+        int active = count;
+
+        for (int i = 0; i < count; i++) {
+            Sha256Lane *l = &lanes[i];
+            memcpy(l->state, start->state, sizeof(l->state));
+            l->head = start->buffer;
+            l->head_len = start->buffer_len;
+            l->msg = msgs[base + i];
+            l->msg_len = lens[base + i];
+            l->bits = (start->total_len + l->msg_len) * 8;
+            l->blocks = (l->head_len + l->msg_len + 9 + 63) / 64;
+            l->done = 0;
+        }
+        while (active > 0) {
+            uint32_t *states[SHA256_MAX_LANES];
+            const uint8_t *blocks[SHA256_MAX_LANES];
+            int idx[SHA256_MAX_LANES], m = 0;
+
+            for (int i = 0; i < count; i++) {
+                if (lanes[i].done == lanes[i].blocks) continue;
+                lane_fill(&lanes[i]);
+                states[m] = lanes[i].state;
+                blocks[m] = lanes[i].block;
+                idx[m++] = i;
+            }
+            for (int j = 0; j < m; j += k->lanes) {
+                k->compress(states + j, blocks + j, m - j < k->lanes ? m - j : k->lanes);
+            }
+            for (int j = 0; j < m; j++) {
+                Sha256Lane *l = &lanes[idx[j]];
+                if (++l->done == l->blocks) {
+                    store_digest(l->state, digests[base + idx[j]]);
+                    active--;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,292 @@
+#include "utils.h"
+#include "snapshot.h"
+#include "user.h"
+#include "post_state.h"
+#include "ledger.h"
+#include <unistd.h>
+
+// ---------------------------------------------------------
+// WRITER CON CRC INCREMENTALE
+// ---------------------------------------------------------
+typedef struct {
+    FILE *f;
+    uint32_t crc;
+    int error;
+} SnapWriter;
+
+static void snap_write(SnapWriter *w, const void *data, size_t n) {
+    if (w->error) return;
+    if (fwrite(data, 1, n, w->f) != n) { w->error = 1; return; }
+    w->crc = crc32_update(w->crc, data, n);
+}
+
+static void snap_write_u32(SnapWriter *w, uint32_t v) {
+    snap_write(w, &v, sizeof(v));
+}
+
+// Layout delle struct: uno snapshot scritto da una build diversa va scartato
+static uint32_t snapshot_layout(void) {
+    return (uint32_t)(sizeof(UserState) ^ (sizeof(PostState) << 8) ^ (sizeof(CommitNode) << 16) ^
+                      (sizeof(RevealNode) << 20) ^ (sizeof(CommentNode) << 24) ^ REL_MAP_SIZE);
+}
+
+// Le chiavi internate vanno scritte tutte, in ordine di ID: post, voti e
+// relazioni le riferiscono per ID. Un utente registrato porta il suo stato,
+// una chiave solo internata il testo.
+static void write_keys(SnapWriter *w) {
+    uint32_t count = (uint32_t)world_state->count;
+    snap_write_u32(w, count);
+    for (UserId id = 0; id < count; id++) {
+        const UserState *u = state_user_by_id(id);
+        uint8_t registered = u != NULL;
+        snap_write(w, &registered, 1);
+        if (u) snap_write(w, u, sizeof(UserState));
+        else snap_write(w, state_user_pubkey(id), SIGNATURE_LEN);
+    }
+}
+
+// Le liste vengono scritte nel loro ordine (dalla testa) e ricostruite identiche
+static void write_post(void *key, void *value, void *ctx) {
+    (void)key;
+    SnapWriter *w = ctx;
+    const PostState *p = value;
+    uint32_t n;
+
+    snap_write(w, p, sizeof(PostState));
+
+    n = 0;
+    for (CommitNode *c = p->commits; c; c = c->next) n++;
+    snap_write_u32(w, n);
+    for (CommitNode *c = p->commits; c; c = c->next) snap_write(w, c, sizeof(CommitNode));
+
+    n = 0;
+    for (RevealNode *r = p->reveals; r; r = r->next) n++;
+    snap_write_u32(w, n);
+    for (RevealNode *r = p->reveals; r; r = r->next) snap_write(w, r, sizeof(RevealNode));
+
+    n = 0;
+    for (CommentNode *k = p->comments; k; k = k->next) n++;
+    snap_write_u32(w, n);
+    for (CommentNode *k = p->comments; k; k = k->next) snap_write(w, k, sizeof(CommentNode));
+}
+
+// ---------------------------------------------------------
+// SALVATAGGIO SNAPSHOT
+// ---------------------------------------------------------
+// Scrittura atomica: file temporaneo + rename. Lo snapshot precedente
+// resta come '<path>.prev' nel caso il nuovo risultasse illeggibile.
+int snapshot_save(const char *path, int height, const uint8_t *block_hash) {
+    char tmp_path[512], prev_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    snprintf(prev_path, sizeof(prev_path), "%s.prev", path);
+
+    SnapWriter w = { .f = fopen(tmp_path, "wb"), .crc = 0, .error = 0 };
+    if (!w.f) {
+        perror("[SNAPSHOT] Cannot write snapshot");
+        return 0;
+    }
+
+    int64_t tokens = global_tokens_circulating;
+
+    snap_write(&w, SNAPSHOT_MAGIC, 4);
+    snap_write_u32(&w, SNAPSHOT_VERSION);
+    snap_write_u32(&w, snapshot_layout());
+    snap_write(&w, &height, sizeof(height));
+    snap_write(&w, block_hash, HASH_SIZE);
+    snap_write(&w, &tokens, sizeof(tokens));
+
+    write_keys(&w);
+
+    snap_write_u32(&w, (uint32_t)global_post_index->count);
+    map_foreach(global_post_index, write_post, &w);
+
+    uint32_t relations = 0;
+    for (int i = 0; i < REL_MAP_SIZE; i++) {
+        for (RelationNode *r = relation_map[i]; r; r = r->next) relations++;
+    }
+    snap_write_u32(&w, relations);
+    for (uint32_t i = 0; i < REL_MAP_SIZE; i++) {
+        for (RelationNode *r = relation_map[i]; r; r = r->next) {
+            snap_write_u32(&w, i);
+            snap_write_u32(&w, r->follower);
+            snap_write_u32(&w, r->target);
+        }
+    }
+
+    uint32_t crc = w.crc;
+    snap_write(&w, &crc, sizeof(crc));
+
+    if (w.error || fflush(w.f) != 0 || fsync(fileno(w.f)) != 0) w.error = 1;
+    fclose(w.f);
+    if (w.error) {
+        fprintf(stderr, "[SNAPSHOT] ❌ Scrittura snapshot fallita.\n");
+        remove(tmp_path);
+        return 0;
+    }
+
+    if (access(path, F_OK) == 0 && rename(path, prev_path) != 0) perror("[SNAPSHOT] rename");
+    if (rename(tmp_path, path) != 0) {
+        perror("[SNAPSHOT] rename");
+        return 0;
+    }
+    node_printf("[SNAPSHOT] 📸 Stato salvato all'altezza #%d.\n", height);
+    return 1;
+}
+
+// ---------------------------------------------------------
+// READER CON BOUNDS CHECK
+// ---------------------------------------------------------
+typedef struct {
+    const unsigned char *p;
+    size_t len;
+    size_t pos;
+    int error;
+} SnapReader;
+
+static int snap_read(SnapReader *r, void *out, size_t n) {
+    if (r->error || r->pos + n > r->len) { r->error = 1; return 0; }
+    memcpy(out, r->p + r->pos, n);
+    r->pos += n;
+    return 1;
+}
+
+static uint32_t snap_read_u32(SnapReader *r) {
+    uint32_t v = 0;
+    snap_read(r, &v, sizeof(v));
+    return v;
+}
+
+// Ricostruisce una lista nello stesso ordine in cui è stata scritta
+#define SNAP_READ_LIST(r, head, NodeType)                          \
+    do {                                                           \
+        uint32_t n_ = snap_read_u32(r);                            \
+        NodeType **tail_ = &(head);                                \
+        (head) = NULL;                                             \
+        for (uint32_t i_ = 0; i_ < n_ && !(r)->error; i_++) {      \
+            NodeType *node_ = post_state_alloc(sizeof(NodeType));  \
+            if (!snap_read(r, node_, sizeof(NodeType))) break;     \
+            node_->next = NULL;                                    \
+            *tail_ = node_;                                        \
+            tail_ = &node_->next;                                  \
+        }                                                          \
+    } while (0)
+
+static int restore_state(SnapReader *r) {
+    // Reinternando nello stesso ordine ogni chiave riprende il suo ID
+    uint32_t keys = snap_read_u32(r);
+    for (uint32_t i = 0; i < keys && !r->error; i++) {
+        uint8_t registered = 0;
+        UserState u;
+        snap_read(r, &registered, 1);
+        if (registered) {
+            if (!snap_read(r, &u, sizeof(u))) break;
+            u.wallet_address[SIGNATURE_LEN - 1] = '\0';
+            state_update_user(u.wallet_address, &u);
+        } else {
+            if (!snap_read(r, u.wallet_address, SIGNATURE_LEN)) break;
+            u.wallet_address[SIGNATURE_LEN - 1] = '\0';
+            state_intern(u.wallet_address);
+        }
+        if (state_user_id(u.wallet_address) != i) r->error = 1;
+    }
+
+    uint32_t posts = snap_read_u32(r);
+    for (uint32_t i = 0; i < posts && !r->error; i++) {
+        PostState *p = post_state_alloc(sizeof(PostState));
+        if (!snap_read(r, p, sizeof(PostState))) break;
+        SNAP_READ_LIST(r, p->commits, CommitNode);
+        SNAP_READ_LIST(r, p->reveals, RevealNode);
+        SNAP_READ_LIST(r, p->comments, CommentNode);
+        map_put(global_post_index, (void*)(uintptr_t)p->post_id, p);
+    }
+
+    // Inserimento in coda al bucket: l'ordine delle catene resta invariato
+    RelationNode *tails[REL_MAP_SIZE] = {0};
+    uint32_t relations = snap_read_u32(r);
+    for (uint32_t i = 0; i < relations && !r->error; i++) {
+        uint32_t bucket = snap_read_u32(r);
+        UserId follower = snap_read_u32(r);
+        UserId target = snap_read_u32(r);
+        if (r->error || bucket >= REL_MAP_SIZE || follower >= keys || target >= keys) {
+            r->error = 1;
+            break;
+        }
+        RelationNode *node = safe_zalloc(sizeof(RelationNode));
+        node->follower = follower;
+        node->target = target;
+        if (tails[bucket]) tails[bucket]->next = node;
+        else relation_map[bucket] = node;
+        tails[bucket] = node;
+    }
+    return !r->error;
+}
+
+static int load_one(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    if (size < 4 + 4 + 4 + 4 + HASH_SIZE + 8 + 4) { fclose(f); return -1; }
+
+    unsigned char *buf = safe_zalloc((size_t)size);
+    size_t got = fread(buf, 1, (size_t)size, f);
+    fclose(f);
+
+    uint32_t stored_crc;
+    memcpy(&stored_crc, buf + size - 4, sizeof(stored_crc));
+    SnapReader r = { .p = buf, .len = (size_t)size - 4, .pos = 0, .error = 0 };
+
+    char magic[4];
+    uint8_t hash[HASH_SIZE];
+    int height = -1;
+    int64_t tokens = 0;
+    snap_read(&r, magic, 4);
+    uint32_t version = snap_read_u32(&r);
+    uint32_t layout = snap_read_u32(&r);
+    snap_read(&r, &height, sizeof(height));
+    snap_read(&r, hash, sizeof(hash));
+    snap_read(&r, &tokens, sizeof(tokens));
+
+    // Lo snapshot vale solo se il blocco a quell'altezza è ancora nel ledger
+    Block tagged = {0};
+    int valid = got == (size_t)size && memcmp(magic, SNAPSHOT_MAGIC, 4) == 0 && version == SNAPSHOT_VERSION &&
+                layout == snapshot_layout() && crc32_update(0, buf, r.len) == stored_crc &&
+                get_block_by_index(height, &tagged) && memcmp(tagged.curr_hash, hash, HASH_SIZE) == 0;
+    block_release(&tagged);
+    if (!valid) {
+        free(buf);
+        return -1;
+    }
+
+    int ok = restore_state(&r) && r.pos == r.len;
+    free(buf);
+
+    if (!ok) {
+        // Stato parziale: si torna allo stato vuoto per un replay completo
+        state_cleanup();
+        post_index_cleanup();
+        state_init();
+        post_index_init();
+        return -1;
+    }
+    global_tokens_circulating = tokens;
+    return height;
+}
+
+// ---------------------------------------------------------
+// CARICAMENTO SNAPSHOT
+// ---------------------------------------------------------
+int snapshot_load(const char *path) {
+    char prev_path[512];
+    snprintf(prev_path, sizeof(prev_path), "%s.prev", path);
+
+    int height = load_one(path);
+    if (height < 0) height = load_one(prev_path);
+
+    if (height >= 0) {
+        printf("[SNAPSHOT] Stato ripristinato all'altezza #%d (Supply: %lld).\n", height, global_tokens_circulating);
+    }
+    return height;
+}
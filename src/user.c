@@ -1,10 +1,13 @@
 #include "user.h"
 #include "post_state.h" 
+#include "snapshot.h"
+#include "mempool.h"
+#include "hex.h"
 #include <string.h>
 #include "wwyl_config.h"
 #include <openssl/rand.h>
 
-HashMap *world_state = NULL; 
+UserTable *world_state = NULL; 
 RelationNode *relation_map[REL_MAP_SIZE];
 long long global_tokens_circulating = 0;
 
@@ -30,77 +33,234 @@ unsigned long hash_djb2(const char *str, int map_size) {
 // ------------------------------------------------------------
 // HASH FUNCTION RELATION MAP
 // ------------------------------------------------------------
-unsigned long hash_rel(const char *key) {
-    unsigned long hash = 5381;
-    int c;
-    while ((c = *key++)) hash = ((hash << 5) + hash) + c;
-    return hash % REL_MAP_SIZE;
+static unsigned long hash_rel(UserId follower, UserId target) {
+    uint64_t h = (((uint64_t)follower << 32) | target) * 0x9E3779B97F4A7C15ULL;
+    return (unsigned long)(h >> 32) % REL_MAP_SIZE;
+}
+
+// -----------------------------------------------------------
+// TABELLA UTENTI (INTERNING)
+// -----------------------------------------------------------
+// Chiave testuale -> chiave dell'indice. Una stringa che non è una chiave
+// pubblica in hex (len 0) usa come prefisso un hash FNV-1a del testo.
+// 0 se il testo non entra in wallet_address.
+static int user_key_parse(const char *text, UserKey *k) {
+    size_t len = strnlen(text, SIGNATURE_LEN);
+    if (len == SIGNATURE_LEN) return 0;
+
+    if (len == USER_KEY_MAX * 2 || len == USER_KEY_COMPRESSED * 2) {
+        int letters = hex_decode_case(text, k->bytes, len / 2);
+        if (letters >= 0) {
+            k->len = (uint8_t)(len / 2);
+            k->letters = (uint8_t)letters;
+            return 1;
+        }
+    }
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)text[i]) * 0x100000001B3ULL;
+    memset(k, 0, sizeof(*k));
+    memcpy(k->bytes + 1, &h, sizeof(h));
+    return 1;
+}
+
+// Il primo byte è il prefisso di formato (04/02/03): si salta
+static uint64_t user_key_prefix(const UserKey *k) {
+    uint64_t p;
+    memcpy(&p, k->bytes + 1, sizeof(p));
+    return p;
+}
+
+static size_t user_slot_index(const UserTable *t, uint64_t prefix) {
+    return (size_t)((prefix * 0x9E3779B97F4A7C15ULL) >> 32) & (t->capacity - 1);
+}
+
+static UserEntry *user_entry_at(const UserTable *t, UserId id) {
+    return &t->chunks[id / USER_CHUNK][id % USER_CHUNK];
+}
+
+// Con lettere miste (o senza byte decodificati) la grafia non è ricostruibile:
+// si confronta la stringa
+static int user_key_equal(const UserEntry *e, const UserKey *k, const char *text) {
+    if (e->key.len != k->len || e->key.letters != k->letters) return 0;
+    if (memcmp(e->key.bytes, k->bytes, k->len) != 0) return 0;
+    if (k->len != 0 && k->letters != (HEX_HAS_LOWER | HEX_HAS_UPPER)) return 1;
+    return strcmp(e->state.wallet_address, text) == 0;
+}
+
+// Ritorna lo slot della chiave, oppure il primo slot vuoto della sua sequenza
+static UserSlot *user_table_find(const UserTable *t, const UserKey *k, const char *text) {
+    uint64_t prefix = user_key_prefix(k);
+    size_t mask = t->capacity - 1;
+    for (size_t i = user_slot_index(t, prefix);; i = (i + 1) & mask) {
+        UserSlot *s = &t->slots[i];
+        if (!s->entry) return s;
+        if (s->prefix == prefix && user_key_equal(s->entry, k, text)) return s;
+    }
+}
+
+static void user_table_grow(UserTable *t) {
+    UserSlot *old = t->slots;
+    size_t old_cap = t->capacity;
+
+    t->capacity *= 2;
+    t->slots = safe_zalloc(t->capacity * sizeof(UserSlot));
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old[i].entry) continue;
+        size_t j = user_slot_index(t, old[i].prefix);
+        while (t->slots[j].entry) j = (j + 1) & (t->capacity - 1);
+        t->slots[j] = old[i];
+    }
+    free(old);
+}
+
+// Nuova voce in coda con il prossimo ID: i blocchi già allocati non si spostano mai
+static UserEntry *user_table_append(UserTable *t) {
+    if (t->count % USER_CHUNK == 0) {
+        size_t chunk = (size_t)t->count / USER_CHUNK;
+        if (chunk == t->chunk_cap) {
+            size_t cap = t->chunk_cap ? t->chunk_cap * 2 : 4;
+            UserEntry **chunks = safe_zalloc(cap * sizeof(UserEntry *));
+            if (t->chunks) memcpy(chunks, t->chunks, t->chunk_cap * sizeof(UserEntry *));
+            free(t->chunks);
+            t->chunks = chunks;
+            t->chunk_cap = cap;
+        }
+        t->chunks[chunk] = safe_zalloc(USER_CHUNK * sizeof(UserEntry));
+    }
+    UserEntry *e = user_entry_at(t, (UserId)t->count);
+    e->id = (UserId)t->count++;
+    return e;
+}
+
+static UserEntry *user_table_lookup(const UserTable *t, const char *text) {
+    UserKey k;
+    if (!t || !user_key_parse(text, &k)) return NULL;
+    return user_table_find(t, &k, text)->entry;
+}
+
+// Voce della chiave, creata (non registrata) se manca
+static UserEntry *user_table_intern(UserTable *t, const char *text) {
+    UserKey k;
+    if (!user_key_parse(text, &k)) return NULL;
+    UserSlot *s = user_table_find(t, &k, text);
+    if (s->entry) return s->entry;
+
+    if ((size_t)(t->count + 1) * 2 > t->capacity) {
+        user_table_grow(t);
+        s = user_table_find(t, &k, text);
+    }
+    s->prefix = user_key_prefix(&k);
+    s->entry = user_table_append(t);
+    s->entry->key = k;
+    snprintf(s->entry->state.wallet_address, SIGNATURE_LEN, "%s", text);
+    return s->entry;
 }
 
 // -----------------------------------------------------------
 // INITIALIZE STATE
 // -----------------------------------------------------------
 void state_init() {
-    world_state = map_create(INITIAL_MAP_SIZE, hash_str, cmp_str, free, free);
+    world_state = safe_zalloc(sizeof(UserTable));
+    world_state->capacity = INITIAL_MAP_SIZE;
+    world_state->slots = safe_zalloc(INITIAL_MAP_SIZE * sizeof(UserSlot));
 }
 
 // -----------------------------------------------------------
 // GET USER STATE
 // -----------------------------------------------------------
 UserState *state_get_user(const char *wallet_address) {
-    if (!world_state) return NULL;
-    return (UserState *)map_get(world_state, wallet_address);
+    UserEntry *e = user_table_lookup(world_state, wallet_address);
+    return e && e->registered ? &e->state : NULL;
+}
+
+// -----------------------------------------------------------
+// GET OR CREATE USER STATE
+// -----------------------------------------------------------
+// Upsert in place: il record restituito vive nella tabella, nessuna copia.
+// Un record nuovo è azzerato con il solo wallet_address valorizzato.
+UserState *state_get_or_create(const char *wallet_address, int *created) {
+    if (created) *created = 0;
+    UserEntry *e = user_table_intern(world_state, wallet_address);
+    if (!e) {
+        node_printf("[STATE] ⚠️ Indirizzo non valido: %.16s...\n", wallet_address);
+        return NULL;
+    }
+    if (!e->registered) {
+        e->registered = 1;
+        if (created) *created = 1;
+    }
+    return &e->state;
 }
 
 // -----------------------------------------------------------
 // UPDATE USER STATE
 // -----------------------------------------------------------
 void state_update_user(const char *wallet_address, const UserState *new_state) {
-    UserState *stored_state = safe_zalloc(sizeof(UserState));
-    memcpy(stored_state, new_state, sizeof(UserState));
+    UserState *stored = state_get_or_create(wallet_address, NULL);
+    if (stored) memcpy(stored, new_state, sizeof(UserState));
+}
 
-    char *key_dup = strdup(wallet_address);
-    
-    map_put(world_state, key_dup, stored_state);
+// -----------------------------------------------------------
+// INTERNING DELLE CHIAVI
+// -----------------------------------------------------------
+UserId state_intern(const char *pubkey) {
+    UserEntry *e = user_table_intern(world_state, pubkey);
+    return e ? e->id : USER_ID_NONE;
+}
+
+UserId state_user_id(const char *pubkey) {
+    UserEntry *e = user_table_lookup(world_state, pubkey);
+    return e ? e->id : USER_ID_NONE;
+}
+
+const char *state_user_pubkey(UserId id) {
+    if (!world_state || id >= (UserId)world_state->count) return NULL;
+    return user_entry_at(world_state, id)->state.wallet_address;
+}
+
+UserState *state_user_by_id(UserId id) {
+    if (!world_state || id >= (UserId)world_state->count) return NULL;
+    UserEntry *e = user_entry_at(world_state, id);
+    return e->registered ? &e->state : NULL;
 }
 
 // -----------------------------------------------------------
 // ADD NEW USER
 // -----------------------------------------------------------
 void state_add_new_user(const char *wallet_address, const char *username, const char *bio, const char *pic) {
-    UserState u = {0};
-    snprintf(u.wallet_address, SIGNATURE_LEN, "%s", wallet_address);
-    if(username) snprintf(u.username, 32, "%s", username);
-    if(bio) snprintf(u.bio, 64, "%s", bio);
-    if(pic) snprintf(u.pic_url, 128, "%s", pic);
+    UserState *u = state_get_or_create(wallet_address, NULL);
+    if (!u) return;
+
+    // Una registrazione riparte da zero anche se la chiave era già nota
+    memset(u, 0, sizeof(*u));
+    snprintf(u->wallet_address, SIGNATURE_LEN, "%s", wallet_address);
+    if(username) snprintf(u->username, 32, "%s", username);
+    if(bio) snprintf(u->bio, 64, "%s", bio);
+    if(pic) snprintf(u->pic_url, 128, "%s", pic);
     
     long long initial_balance = 0; // <--- DEFAULT ZERO
 
     if (strcmp(wallet_address, GOD_PUB_KEY) == 0) {
         initial_balance = GLOBAL_TOKEN_LIMIT / 2; 
-        printf("👑 GOD USER DETECTED.\n");
+        node_printf("👑 GOD USER DETECTED.\n");
     }
 
     if (mineTokens(initial_balance)) {
-        u.token_balance = initial_balance;
-    } else {
-        u.token_balance = 0; 
+        u->token_balance = initial_balance;
     }
 
-    state_update_user(wallet_address, &u);
-    printf("[STATE] New User: %s (Bal: %d)\n", u.username, u.token_balance);
+    node_printf("[STATE] New User: %s (Bal: %d)\n", u->username, u->token_balance);
 }
 
 // -----------------------------------------------------------
 // CLEANUP STATE
 // -----------------------------------------------------------
 int state_check_follow_status(const char *follower, const char *target) {
-    char key[2048];
-    snprintf(key, sizeof(key), "%s:%s", follower, target);
-    unsigned long idx = hash_rel(key);
-    RelationNode *curr = relation_map[idx];
+    UserId f = state_user_id(follower), t = state_user_id(target);
+    if (f == USER_ID_NONE || t == USER_ID_NONE) return 0;
+    RelationNode *curr = relation_map[hash_rel(f, t)];
     while (curr) {
-        if (strcmp(curr->key, key) == 0) return 1;
+        if (curr->follower == f && curr->target == t) return 1;
         curr = curr->next;
     }
     return 0;
@@ -110,15 +270,15 @@ int state_check_follow_status(const char *follower, const char *target) {
 // TOGGLE FOLLOW STATUS
 // -----------------------------------------------------------
 void state_toggle_follow(const char *follower, const char *target) {
-    char key[2048];
-    snprintf(key, sizeof(key), "%s:%s", follower, target);
-    unsigned long idx = hash_rel(key);
-    UserState *u_follower = state_get_user(follower);
-    UserState *u_target = state_get_user(target);
+    UserId f = state_intern(follower), t = state_intern(target);
+    if (f == USER_ID_NONE || t == USER_ID_NONE) return;
+    unsigned long idx = hash_rel(f, t);
+    UserState *u_follower = state_user_by_id(f);
+    UserState *u_target = state_user_by_id(t);
     RelationNode *curr = relation_map[idx];
     RelationNode *prev = NULL;
     while (curr) {
-        if (strcmp(curr->key, key) == 0) {
+        if (curr->follower == f && curr->target == t) {
             if (prev) prev->next = curr->next;
             else relation_map[idx] = curr->next;
             free(curr);
@@ -130,7 +290,8 @@ void state_toggle_follow(const char *follower, const char *target) {
         curr = curr->next;
     }
     RelationNode *node = (RelationNode*)safe_zalloc(sizeof(RelationNode));
-    strcpy(node->key, key);
+    node->follower = f;
+    node->target = t;
     node->next = relation_map[idx];
     relation_map[idx] = node;
     if (u_follower) u_follower->following_count++;
@@ -152,7 +313,7 @@ void finalize_post_rewards(int post_id) {
         curr = curr->next;
     }
 
-    UserState *author = state_get_user(p->author_pubkey);
+    UserState *author = state_user_by_id(p->author_id);
     if (author) {
         if (winning_vote == 1) { 
             author->current_streak++;
@@ -160,11 +321,11 @@ void finalize_post_rewards(int post_id) {
             int bonus = author->current_streak*2;
             if (mineTokens(bonus)) {
                 author->token_balance += bonus;
-                printf("🔥 [STREAK] Author Streak x%d! Minted +%d Tokens. (Bal: %d)\n", 
-                       author->current_streak, bonus, author->token_balance);
+                node_printf("🔥 [STREAK] Author Streak x%d! Minted +%d Tokens. (Bal: %d)\n", 
+                            author->current_streak, bonus, author->token_balance);
             }
         } else {
-            printf("❄️ [STREAK] Author Streak Reset. Post rejected.\n");
+            node_printf("❄️ [STREAK] Author Streak Reset. Post rejected.\n");
             author->current_streak = 0;
         }
     }
@@ -174,10 +335,10 @@ void finalize_post_rewards(int post_id) {
         curr = p->reveals;
         while(curr) {
             if (curr->vote_value == winning_vote) {
-                UserState *u = state_get_user(curr->voter_pubkey);
+                UserState *u = state_user_by_id(curr->voter_id);
                 if (u) {
                     u->token_balance += reward;
-                    printf("💰 [PAYOUT] Voter %.8s... won %d tokens!\n", u->wallet_address, reward);
+                    node_printf("💰 [PAYOUT] Voter %.8s... won %d tokens!\n", u->wallet_address, reward);
                 }
             }
             curr = curr->next;
@@ -185,97 +346,125 @@ void finalize_post_rewards(int post_id) {
     }
     p->finalized = 1;
     p->is_open = 0;
-    printf("[ECONOMY] Post #%d Finalized. Pool: %d.\n", post_id, p->pull);
+    node_printf("[ECONOMY] Post #%d Finalized. Pool: %d.\n", post_id, p->pull);
 }
 
 // -----------------------------------------------------------
-// REBUILD STATE FROM CHAIN
+// APPLY BLOCK TO STATE
 // -----------------------------------------------------------
-void rebuild_state_from_chain(Block *genesis) {
-    printf("[STATE] 🔄 Replaying Blockchain History con Prezzi Dinamici...\n");
-    
-    // 1. Reset totale dell'economia
-    global_tokens_circulating = 0; 
-    
-    Block *curr = genesis;
-    while(curr != NULL) {
-        // Calcoliamo il moltiplicatore che c'era IN QUEL MOMENTO
-        // Basato sui token circolanti prima di processare questo blocco
-        float historical_mult = get_economy_multiplier();
-
-        if (curr->type == ACT_REGISTER_USER) {
-            PayloadRegister *reg = &curr->data.registration;
-            // Se è il blocco genesi o una registrazione normale
-            if (curr->index == 0) {
-                 // Nota: state_add_new_user aggiorna global_tokens_circulating
-                state_add_new_user(curr->sender_pubkey, reg->username, reg->bio, reg->pic_url);
-            } else {
-                // Per utenti successivi al genesi
-                 state_add_new_user(curr->sender_pubkey, reg->username, reg->bio, reg->pic_url);
-            }
-        }
-        else if (curr->type == ACT_POST_CONTENT) {
-            post_index_add(curr->index, curr->sender_pubkey);
-            UserState *u = state_get_user(curr->sender_pubkey);
-            
-            // Calcolo il costo storico!
-            int historical_cost = (int)(COSTO_POST * historical_mult);
-
-            if(u && u->token_balance >= historical_cost) {
-                u->token_balance -= historical_cost;
-                
-                PostState *p = post_index_get(curr->index);
-                if(p) { 
-                    p->pull += historical_cost; // Il pool cresce col prezzo pagato
-                    p->created_at = curr->timestamp; 
-                }
-            }
-        }
-        else if (curr->type == ACT_VOTE_COMMIT) {
-            int pid = curr->data.commit.target_post_id;
-            post_register_commit(pid, curr->sender_pubkey, curr->data.commit.vote_hash);
-            UserState *u = state_get_user(curr->sender_pubkey);
+// Applica gli effetti di una singola azione allo stato in RAM. Altezza e
+// timestamp sono quelli del blocco che la contiene (ID dei post, scadenze).
+static void state_apply_action(const Block *curr, ActionType type, const char *sender_pubkey, const ActionPayload *data) {
+    // Calcoliamo il moltiplicatore che c'era IN QUEL MOMENTO
+    // Basato sui token circolanti prima di processare questa azione
+    float historical_mult = get_economy_multiplier();
+
+    if (type == ACT_REGISTER_USER) {
+        const PayloadRegister *reg = &data->registration;
+        // Nota: state_add_new_user aggiorna global_tokens_circulating (GOD nel blocco genesi)
+        state_add_new_user(sender_pubkey, reg->username, reg->bio, reg->pic_url);
+    }
+    else if (type == ACT_POST_CONTENT) {
+        post_index_add(curr->index, state_intern(sender_pubkey));
+        UserState *u = state_get_user(sender_pubkey);
+        
+        // Calcolo il costo storico!
+        int historical_cost = (int)(COSTO_POST * historical_mult);
+
+        if(u && u->token_balance >= historical_cost) {
+            u->token_balance -= historical_cost;
             
-            // Calcolo il costo storico!
-            int historical_cost = (int)(COSTO_VOTO * historical_mult);
-
-            if(u && u->token_balance >= historical_cost) {
-                u->token_balance -= historical_cost;
-                
-                PostState *p = post_index_get(pid);
-                if(p) p->pull += historical_cost;
+            PostState *p = post_index_get(curr->index);
+            if(p) { 
+                p->pull += historical_cost; // Il pool cresce col prezzo pagato
+                p->created_at = curr->timestamp; 
             }
         }
-        else if (curr->type == ACT_VOTE_REVEAL) {
-            int pid = curr->data.reveal.target_post_id;
-            post_register_reveal(pid, curr->sender_pubkey, curr->data.reveal.vote_value);
-        }
-        else if (curr->type == ACT_FOLLOW_USER) {
-            state_toggle_follow(curr->sender_pubkey, curr->data.follow.target_user_pubkey);
-        }
-        else if (curr->type == ACT_POST_FINALIZE) {
-            int pid = curr->data.finalize.target_post_id;
-            // Questa funzione al suo interno chiama mineTokens() per i bonus streak,
-            // quindi aggiorna global_tokens_circulating correttamente per i blocchi successivi.
-            finalize_post_rewards(pid);
-        }
-        else if (curr->type == ACT_POST_COMMENT) {
-            int pid = curr->data.comment.target_post_id;
-            post_register_comment(pid, curr->sender_pubkey, curr->data.comment.content, curr->timestamp);
-       }
-       else if (curr->type == ACT_TRANSFER) {
-            UserState *sender = state_get_user(curr->sender_pubkey);
-            UserState *receiver = state_get_user(curr->data.transfer.target_pubkey);
-            int amount = curr->data.transfer.amount;
+    }
+    else if (type == ACT_VOTE_COMMIT) {
+        int pid = data->commit.target_post_id;
+        post_register_commit(pid, state_intern(sender_pubkey), data->commit.vote_hash);
+        UserState *u = state_get_user(sender_pubkey);
+        
+        // Calcolo il costo storico!
+        int historical_cost = (int)(COSTO_VOTO * historical_mult);
+
+        if(u && u->token_balance >= historical_cost) {
+            u->token_balance -= historical_cost;
             
-            if (sender && receiver && sender->token_balance >= amount) {
-                sender->token_balance -= amount;
-                receiver->token_balance += amount;
-            }
+            PostState *p = post_index_get(pid);
+            if(p) p->pull += historical_cost;
         }
+    }
+    else if (type == ACT_VOTE_REVEAL) {
+        int pid = data->reveal.target_post_id;
+        post_register_reveal(pid, state_intern(sender_pubkey), data->reveal.vote_value);
+    }
+    else if (type == ACT_FOLLOW_USER) {
+        state_toggle_follow(sender_pubkey, data->follow.target_user_pubkey);
+    }
+    else if (type == ACT_POST_FINALIZE) {
+        int pid = data->finalize.target_post_id;
+        // Questa funzione al suo interno chiama mineTokens() per i bonus streak,
+        // quindi aggiorna global_tokens_circulating correttamente per i blocchi successivi.
+        finalize_post_rewards(pid);
+    }
+    else if (type == ACT_POST_COMMENT) {
+        int pid = data->comment.target_post_id;
+        post_register_comment(pid, state_intern(sender_pubkey), data->comment.content, curr->timestamp);
+    }
+    else if (type == ACT_TRANSFER) {
+        UserState *sender = state_get_user(sender_pubkey);
+        UserState *receiver = state_get_user(data->transfer.target_pubkey);
+        int amount = data->transfer.amount;
         
-        curr = curr->next;
+        if (sender && receiver && sender->token_balance >= amount) {
+            sender->token_balance -= amount;
+            receiver->token_balance += amount;
+        }
+    }
+}
+
+// Applica gli effetti di un blocco allo stato in RAM: le azioni di un
+// batch vengono applicate nell'ordine in cui compaiono nel blocco.
+// Usata dal replay: il blocco può essere una copia di appoggio temporanea.
+void state_apply_block(const Block *curr) {
+    if (curr->type != ACT_BATCH) {
+        state_apply_action(curr, curr->type, curr->sender_pubkey, &curr->data);
+        return;
+    }
+    for (int i = 0; i < curr->data.batch.count; i++) {
+        const Action *a = &curr->actions[i];
+        state_apply_action(curr, a->type, a->sender_pubkey, &a->data);
     }
+}
+
+// -----------------------------------------------------------
+// REBUILD STATE FROM CHAIN
+// -----------------------------------------------------------
+// Replay direttamente sul ledger mappato: ogni record viene decodificato
+// nello stesso Block di appoggio, senza costruire la lista in RAM.
+// Con from_height > 0 lo stato fino a from_height - 1 arriva da uno snapshot
+// e si riesegue solo la coda. All'ultimo multiplo di SNAPSHOT_INTERVAL
+// attraversato viene scritto un nuovo snapshot.
+void rebuild_state_from_chain(const LedgerView *view, int from_height) {
+    printf("[STATE] 🔄 Replaying Blockchain History con Prezzi Dinamici (da #%d)...\n", from_height);
+    
+    // 1. Reset totale dell'economia (se non ripristinata da snapshot)
+    if (from_height <= 0) global_tokens_circulating = 0; 
+    
+    long snapshot_height = (view->count / SNAPSHOT_INTERVAL) * SNAPSHOT_INTERVAL - 1;
+    LedgerCursor cursor;
+    Block curr = {0};
+    ledger_cursor_init(&cursor, view);
+    if (!ledger_cursor_seek(&cursor, from_height)) {
+        fatal_error("Blocco #%d non trovato nell'indice del ledger.", from_height);
+    }
+    while (ledger_cursor_next(&cursor, &curr) == 1) {
+        state_apply_block(&curr);
+        if (curr.index == snapshot_height) snapshot_save(STATE_SNAPSHOT_FILE, curr.index, curr.curr_hash);
+    }
+    block_release(&curr);
     printf("[STATE] ✅ Replay Complete. Circulating Supply: %lld\n", global_tokens_circulating);
 }
 
@@ -290,161 +479,123 @@ int check24hrs(time_t post_timestamp, time_t current_time) {
 // ---------------------------------------------------------
 // HASH VOTO
 // ---------------------------------------------------------
-char *hashVote(int post_id, int vote_val, const char *salt, const char *pubkey_hex) {
+void hashVote(int post_id, int vote_val, const char *salt, const char *pubkey_hex, uint8_t *hash_output) {
     char combined[1024]; 
     snprintf(combined, sizeof(combined), "%d:%d:%s:%s", post_id, vote_val, salt, pubkey_hex);
-    char *hash_output = safe_zalloc(HASH_LEN);
-    sha256_hash(combined, strlen(combined), hash_output);
-    return hash_output;
+    sha256_raw(combined, strlen(combined), hash_output);
 }
 
 // ---------------------------------------------------------
 // REGISTER USER
 // ---------------------------------------------------------
-Block *register_user(Block *prev, const void *payload, const char *priv, const char *pub) {
+long register_user(const void *payload, SignSession *signer, const char *pub) {
     if (state_get_user(pub)) {
         printf("⚠️ Utente già registrato.\n");
-        return NULL;
+        return -1;
     }
-    // Nessun controllo sponsor. Chiunque può entrare.
-    Block *b = mine_new_block(prev, ACT_REGISTER_USER, payload, pub, priv);
-    if(b) {
-        const PayloadRegister *reg = (const PayloadRegister*)payload;
-        // La funzione state_add_new_user gestirà il saldo a 0 (tranne per GOD)
-        state_add_new_user(pub, reg->username, reg->bio, reg->pic_url);
+    if (mempool_registration_pending(pub)) {
+        printf("⚠️ Registrazione già in coda.\n");
+        return -1;
     }
-    return b;
+    // Nessun controllo sponsor. Chiunque può entrare.
+    // Saldo iniziale a 0 (tranne per GOD): lo assegna state_add_new_user all'inclusione
+    return mempool_submit(ACT_REGISTER_USER, payload, pub, signer, 0);
 }
 
 // ---------------------------------------------------------
 // POST CONTENT
 // ---------------------------------------------------------
-Block *user_post(Block *prev, const void *payload, const char *priv, const char *pub) {
+long user_post(const void *payload, SignSession *signer, const char *pub) {
     UserState *u = state_get_user(pub);
     
     int current_cost = (int)(COSTO_POST * get_economy_multiplier());
     
-    if (!u || u->token_balance < current_cost) {
+    // Il saldo disponibile esclude quanto già promesso dalle azioni in coda
+    if (!u || u->token_balance - mempool_pending_debit(pub) < current_cost) {
         printf("[ECONOMY] ❌ Fondi insufficienti. Costo attuale: %d (Inflazione: %.2fx)\n", 
                current_cost, get_economy_multiplier());
-        return NULL;
+        return -1;
     }
-    Block *b = mine_new_block(prev, ACT_POST_CONTENT, payload, pub, priv);
-    if (b) {
-        u->token_balance -= current_cost;
-        post_index_add(b->index, pub);
-        PostState *p = post_index_get(b->index);
-        if(p) { p->pull += current_cost; p->created_at = b->timestamp; }
-    }
-    return b;
+    // Costo, pool e ID del post (= altezza del blocco) arrivano all'inclusione
+    return mempool_submit(ACT_POST_CONTENT, payload, pub, signer, current_cost);
 }
 
 // ---------------------------------------------------------
 // COMMIT VOTE
 // ---------------------------------------------------------
-Block *user_like(Block *prev, const void *payload, const char *priv, const char *pub) {
+long user_like(const void *payload, SignSession *signer, const char *pub) {
     UserState *u = state_get_user(pub);
     
-    int current_cost = (int)(COSTO_POST * get_economy_multiplier());
+    int current_cost = (int)(COSTO_VOTO * get_economy_multiplier());
     
-    if (!u || u->token_balance < current_cost) {
+    if (!u || u->token_balance - mempool_pending_debit(pub) < current_cost) {
         printf("[ECONOMY] ❌ Fondi insufficienti. Costo attuale: %d (Inflazione: %.2fx)\n", 
                current_cost, get_economy_multiplier());
-        return NULL;
+        return -1;
     }
     const PayloadReveal *raw = (const PayloadReveal *)payload; 
     PostState *post = post_index_get(raw->target_post_id);
-    if (!post) { printf("Post non trovato.\n"); return NULL; }
-    if (!check24hrs(post->created_at, time(NULL))) { printf("[TIME] Scaduto.\n"); return NULL; }
+    if (!post) { printf("Post non trovato.\n"); return -1; }
+    if (!check24hrs(post->created_at, time(NULL))) { printf("[TIME] Scaduto.\n"); return -1; }
 
     PayloadCommit c_data = {0};
     c_data.target_post_id = raw->target_post_id;
-    char *h = hashVote(raw->target_post_id, raw->vote_value, raw->salt_secret, pub);
-    snprintf(c_data.vote_hash, HASH_LEN, "%s", h);
+    hashVote(raw->target_post_id, raw->vote_value, raw->salt_secret, pub, c_data.vote_hash);
     
-    Block *b = mine_new_block(prev, ACT_VOTE_COMMIT, &c_data, pub, priv);
-    if (b) {
-        u->token_balance -= current_cost;
-        post->pull += current_cost;
-        post_register_commit(raw->target_post_id, pub, h);
-    }
-    free(h);
-    return b;
+    return mempool_submit(ACT_VOTE_COMMIT, &c_data, pub, signer, current_cost);
 }
 
 // ---------------------------------------------------------
 // REVEAL VOTE
 // ---------------------------------------------------------
-Block *user_reveal(Block *prev, const void *payload, const char *priv, const char *pub) {
+long user_reveal(const void *payload, SignSession *signer, const char *pub) {
     const PayloadReveal *raw = (const PayloadReveal *)payload;
     PostState *post = post_index_get(raw->target_post_id);
-    if (!post) return NULL;
-    if (check24hrs(post->created_at, time(NULL))) { printf("[TIME] Troppo presto.\n"); return NULL; }
+    if (!post) return -1;
+    if (check24hrs(post->created_at, time(NULL))) { printf("[TIME] Troppo presto.\n"); return -1; }
 
-    char *h = hashVote(raw->target_post_id, raw->vote_value, raw->salt_secret, pub);
-    if (!post_verify_commit(raw->target_post_id, pub, h)) {
+    uint8_t h[HASH_SIZE];
+    hashVote(raw->target_post_id, raw->vote_value, raw->salt_secret, pub, h);
+    if (!post_verify_commit(raw->target_post_id, state_user_id(pub), h)) {
         printf("[REVEAL] ❌ Hash mismatch!\n");
-        free(h);
-        return NULL;
-    }
-    free(h);
-
-    Block *b = mine_new_block(prev, ACT_VOTE_REVEAL, payload, pub, priv);
-    if (b) {
-        post_register_reveal(raw->target_post_id, pub, raw->vote_value);
+        return -1;
     }
-    return b;
+    return mempool_submit(ACT_VOTE_REVEAL, payload, pub, signer, 0);
 }
 
 // ---------------------------------------------------------
 // FOLLOW USER
 // ---------------------------------------------------------
-Block *user_follow(Block *prev, const void *payload, const char *priv, const char *pub) {
-    if (!payload) return NULL;
+long user_follow(const void *payload, SignSession *signer, const char *pub) {
+    if (!payload) return -1;
     
     const PayloadFollow *req = (const PayloadFollow*)payload;
 
     if (!state_get_user(req->target_user_pubkey)) {
         printf("[FOLLOW] ❌ Errore: L'utente target non esiste.\n");
-        return NULL;
+        return -1;
     }
 
     if (strcmp(req->target_user_pubkey, pub) == 0) {
         printf("[FOLLOW] ❌ Non puoi seguire te stesso (Narcisismo non ammesso).\n");
-        return NULL;
+        return -1;
     }
 
-    Block *b = mine_new_block(prev, ACT_FOLLOW_USER, payload, pub, priv);
-
-    if (b) {
-        state_toggle_follow(pub, req->target_user_pubkey);
-        
-        printf("[FOLLOW] ✅ Ora segui (o hai smesso di seguire) l'utente.\n");
-    }
-
-    return b;
+    // È un toggle: all'inclusione segui (o smetti di seguire) l'utente
+    return mempool_submit(ACT_FOLLOW_USER, payload, pub, signer, 0);
 }
 
 // ---------------------------------------------------------
 // COMMENTO POST
 // ---------------------------------------------------------
-Block *user_comment(Block *prev, const void *payload, const char *priv, const char *pub) {
+long user_comment(const void *payload, SignSession *signer, const char *pub) {
     const PayloadComment *req = (const PayloadComment*)payload;
 
     if (!post_index_exists(req->target_post_id)) {
         printf("[COMMENT] ❌ Errore: Post #%d non trovato.\n", req->target_post_id);
-        return NULL;
-    }
-
-    Block *b = mine_new_block(prev, ACT_POST_COMMENT, payload, pub, priv);
-
-    if (b) {
-        printf("[COMMENT] 💬 Commento registrato sul blocco #%d.\n", b->index);
-        
-        const PayloadComment *req = (const PayloadComment*)payload;
-        post_register_comment(req->target_post_id, pub, req->content, b->timestamp);
+        return -1;
     }
-    return b;
+    return mempool_submit(ACT_POST_COMMENT, payload, pub, signer, 0);
 }
 
 // ---------------------------------------------------------
@@ -452,7 +603,10 @@ Block *user_comment(Block *prev, const void *payload, const char *priv, const ch
 // ---------------------------------------------------------
 void state_cleanup() {
     if (world_state) {
-        map_destroy(world_state); 
+        for (size_t i = 0; i < world_state->chunk_cap; i++) free(world_state->chunks[i]);
+        free(world_state->chunks);
+        free(world_state->slots);
+        free(world_state);
         world_state = NULL;
     }
     
@@ -463,6 +617,7 @@ void state_cleanup() {
             curr = curr->next;
             free(tmp);
         }
+        relation_map[i] = NULL;
     }
     printf("[STATE] Memory cleaned up.\n");
 }
@@ -470,7 +625,7 @@ void state_cleanup() {
 // ---------------------------------------------------------
 // AUTENTICAZIONE UTENTE (Challenge-Response)
 // ---------------------------------------------------------
-int user_login(const char *privkey_hex, const char *pubkey_hex) {
+int user_login(SignSession *signer, const char *pubkey_hex) {
     UserState *u = state_get_user(pubkey_hex);
     if (!u) {
         printf("[LOGIN] ❌ Accesso Negato: Utente non registrato.\n");
@@ -488,11 +643,11 @@ int user_login(const char *privkey_hex, const char *pubkey_hex) {
 
     printf("[DEBUG] Challenge: %s\n", challenge_msg);
 
-    char signature[SIGNATURE_LEN];
+    uint8_t signature[SIG_SIZE];
     int is_valid = 0;
     
     // Firma e Verifica
-    ecdsa_sign(privkey_hex, challenge_msg, signature);
+    sign_session_sign(signer, challenge_msg, signature);
     ecdsa_verify(pubkey_hex, challenge_msg, signature, &is_valid);
 
     if (is_valid) { 
@@ -507,58 +662,50 @@ int user_login(const char *privkey_hex, const char *pubkey_hex) {
 // ---------------------------------------------------------
 // FINALIZZAZIONE POST E DISTRIBUZIONE PREMI
 // ---------------------------------------------------------
-Block *user_finalize(Block *prev, const void *payload, const char *priv, const char *pub) {
+long user_finalize(const void *payload, SignSession *signer, const char *pub) {
     const PayloadFinalize *req = (const PayloadFinalize*)payload;
     
     // Controlliamo se il post esiste e non è già chiuso
     PostState *post = post_index_get(req->target_post_id);
-    if (!post) { printf("Post non trovato.\n"); return NULL; }
-    if (post->finalized) { printf("Post già finalizzato.\n"); return NULL; }
+    if (!post) { printf("Post non trovato.\n"); return -1; }
+    if (post->finalized) { printf("Post già finalizzato.\n"); return -1; }
+    if (mempool_finalize_pending(req->target_post_id)) { printf("Finalizzazione già in coda.\n"); return -1; }
 
-    // Minamo il blocco
-    Block *b = mine_new_block(prev, ACT_POST_FINALIZE, payload, pub, priv);
-    
-    if (b) {
-        // Applichiamo subito l'effetto in RAM
-        finalize_post_rewards(req->target_post_id);
-    }
-    return b;
+    // I premi vengono distribuiti quando il blocco viene minato
+    return mempool_submit(ACT_POST_FINALIZE, payload, pub, signer, 0);
 }
 
 // ---------------------------------------------------------
 // TRASFERIMENTO TOKEN TRA UTENTI
 // ---------------------------------------------------------
-Block *user_transfer(Block *prev, const void *payload, const char *priv, const char *pub) {
+long user_transfer(const void *payload, SignSession *signer, const char *pub) {
     const PayloadTransfer *req = (const PayloadTransfer*)payload;
     
     // [FIX] Anti-Auto-Bonifico
     if (strcmp(pub, req->target_pubkey) == 0) {
         printf("❌ Non puoi inviare token a te stesso (inutile spam!).\n");
-        return NULL;
+        return -1;
     }
     UserState *sender = state_get_user(pub);
     UserState *receiver = state_get_user(req->target_pubkey);
 
-    if (!sender || sender->token_balance < req->amount) {
-        printf("❌ Fondi insufficienti (Hai: %d, Vuoi inviare: %d)\n", sender ? sender->token_balance : 0, req->amount);
-        return NULL;
+    int available = sender ? sender->token_balance - mempool_pending_debit(pub) : 0;
+    if (!sender || available < req->amount) {
+        printf("❌ Fondi insufficienti (Disponibili: %d, Vuoi inviare: %d)\n", available, req->amount);
+        return -1;
     }
     if (!receiver) {
         printf("❌ Destinatario non trovato sulla blockchain.\n");
-        return NULL;
+        return -1;
     }
     if (req->amount <= 0) {
         printf("❌ L'importo deve essere positivo.\n");
-        return NULL;
+        return -1;
     }
 
-    Block *b = mine_new_block(prev, ACT_TRANSFER, payload, pub, priv);
-    if (b) {
-        sender->token_balance -= req->amount;
-        receiver->token_balance += req->amount;
-        printf("💸 Trasferimento completato! %d token da @%s a @%s.\n", req->amount, sender->username, receiver->username);
-    }
-    return b;
+    long ticket = mempool_submit(ACT_TRANSFER, payload, pub, signer, req->amount);
+    if (ticket > 0) printf("💸 Trasferimento di %d token da @%s a @%s in coda.\n", req->amount, sender->username, receiver->username);
+    return ticket;
 }
 
 float get_economy_multiplier() {
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include <pthread.h>
 
 // ---------------------------------------------------------
 // GESTIONE ERRORI AVANZATA
@@ -16,6 +17,58 @@ void fatal_error(const char *fmt, ...) {
     exit(EXIT_FAILURE);
 }
 
+// ---------------------------------------------------------
+// OUTPUT DIFFERITO DEL MINER
+// ---------------------------------------------------------
+static _Thread_local int defer_output = 0;
+static pthread_mutex_t deferred_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *deferred = NULL;
+static size_t deferred_len = 0, deferred_cap = 0;
+
+void node_printf_defer(void) {
+    defer_output = 1;
+}
+
+void node_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (!defer_output) {
+        vprintf(fmt, args);
+        va_end(args);
+        return;
+    }
+    char line[1024];
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1; // Riga troncata
+
+    pthread_mutex_lock(&deferred_lock);
+    if (deferred_len + (size_t)n + 1 > deferred_cap) {
+        size_t cap = deferred_cap ? deferred_cap * 2 : 4096;
+        while (cap < deferred_len + (size_t)n + 1) cap *= 2;
+        char *grown = realloc(deferred, cap);
+        if (!grown) fatal_error("Out of memory! Failed to allocate %zu bytes.", cap);
+        deferred = grown;
+        deferred_cap = cap;
+    }
+    memcpy(deferred + deferred_len, line, (size_t)n + 1);
+    deferred_len += (size_t)n;
+    pthread_mutex_unlock(&deferred_lock);
+}
+
+void node_printf_flush(void) {
+    pthread_mutex_lock(&deferred_lock);
+    if (deferred_len > 0) {
+        fwrite(deferred, 1, deferred_len, stdout);
+        deferred_len = 0;
+    }
+    free(deferred);
+    deferred = NULL;
+    deferred_cap = 0;
+    pthread_mutex_unlock(&deferred_lock);
+}
+
 // ---------------------------------------------------------
 // MEMORY ALLOCATOR SICURO (Il vero "Flex")
 // ---------------------------------------------------------
@@ -32,6 +85,29 @@ void *safe_zalloc(size_t size) {
     return ptr;
 }
 
+// ---------------------------------------------------------
+// CRC32 (IEEE 802.3)
+// ---------------------------------------------------------
+// Concatenabile: crc32_update(crc32_update(0, a, n), b, m) == CRC di a||b.
+// Serve a rilevare record scritti a metà o corrotti, non è una difesa crittografica.
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len) {
+    static uint32_t table[256];
+    static int ready = 0;
+    const unsigned char *p = buf;
+
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        ready = 1;
+    }
+    crc ^= 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
 void errExit(const char *msg) {
     perror(msg);
     exit(EXIT_FAILURE);
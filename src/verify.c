@@ -0,0 +1,325 @@
+#include "utils.h"
+#include "verify.h"
+#include "wwyl_crypto.h"
+#include "batch.h"
+#include "sha256.h"
+#include "hex.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+int verify_paranoid = 0;
+int verify_threads = 0;
+
+// Esito della verifica di un blocco: i worker non stampano nulla, il
+// messaggio viene prodotto una sola volta per il primo blocco fallito.
+typedef enum {
+    VERIFY_OK = 0,
+    VERIFY_BROKEN_LINK,
+    VERIFY_TAMPERED,
+    VERIFY_BAD_SIGNATURE,
+    VERIFY_POW_FAILED,
+    VERIFY_BAD_DIFFICULTY,
+    VERIFY_BAD_TIMESTAMP,
+    VERIFY_BAD_BATCH,
+    VERIFY_BAD_ACTION_SIGNATURE,
+    VERIFY_CHECKPOINT_MISMATCH,
+    VERIFY_BAD_INDEX,
+    VERIFY_UNDECODABLE
+} VerifyResult;
+
+// ---------------------------------------------------------
+// CHECKPOINT DI VERIFICA (wwyl_chain.ckpt)
+// ---------------------------------------------------------
+// Coppia (altezza, curr_hash) già verificata per intero in passato. Formato
+// testo "altezza hash": un operatore può anche fissarne uno a mano.
+// L'altezza è la posizione del blocco nel ledger, mai l'index che dichiara.
+int checkpoint_load(const char *path, ChainCheckpoint *cp) {
+    char hex[HASH_LEN];
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int ok = fscanf(f, "%d %64s", &cp->height, hex) == 2 && cp->height >= 0 && hex_parse(hex, cp->hash, HASH_SIZE);
+    fclose(f);
+    return ok;
+}
+
+void checkpoint_save(const char *path, int height, const uint8_t *hash) {
+    char tmp_path[512], hex[HASH_LEN];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) return;
+    hex_encode(hash, HASH_SIZE, hex);
+    fprintf(f, "%d %s\n", height, hex);
+    fclose(f);
+    if (rename(tmp_path, path) != 0) perror("[SECURITY] checkpoint");
+}
+
+// ---------------------------------------------------------
+// VERIFICA SINGOLO BLOCCO
+// ---------------------------------------------------------
+// Sotto il checkpoint si controllano solo il link prev_hash e il ricalcolo
+// SHA256 (per i batch anche la Merkle root, l'unica cosa che l'hash copre):
+// firme ECDSA, difficoltà e PoW sono già state verificate quando il
+// checkpoint è stato registrato. 'pos' è la posizione del blocco nel ledger:
+// l'index dichiarato deve coincidere, altrimenti un blocco accodato dopo la
+// coda potrebbe fingersi sotto il checkpoint. 'window' è il blocco di inizio
+// finestra alle altezze di retarget (NULL altrove). 'content_hash' è lo SHA256
+// del preimage canonico, calcolato dal chiamante insieme a quello dei vicini.
+static VerifyResult verify_block(const Block *prev, const Block *curr, long pos, const Block *window,
+                                 const ChainCheckpoint *cp, const uint8_t *content_hash) {
+    char hash_hex[HASH_LEN];
+    int is_valid = 0;
+
+    if (curr->index != prev->index + 1 || curr->index != pos) return VERIFY_BAD_INDEX;
+    if (memcmp(curr->prev_hash, prev->curr_hash, HASH_SIZE) != 0) return VERIFY_BROKEN_LINK;
+    if (memcmp(content_hash, curr->curr_hash, HASH_SIZE) != 0) return VERIFY_TAMPERED;
+
+    if (curr->type == ACT_BATCH) {
+        uint8_t root[HASH_SIZE];
+        if (!batch_merkle_root(curr, root) || memcmp(root, curr->data.batch.merkle_root, HASH_SIZE) != 0) return VERIFY_BAD_BATCH;
+    }
+
+    if (cp && pos <= cp->height) {
+        if (pos == cp->height && memcmp(curr->curr_hash, cp->hash, HASH_SIZE) != 0) return VERIFY_CHECKPOINT_MISMATCH;
+        return VERIFY_OK;
+    }
+
+    // Il messaggio firmato è l'hash in hex
+    hex_encode(curr->curr_hash, HASH_SIZE, hash_hex);
+    ecdsa_verify(curr->sender_pubkey, hash_hex, curr->signature, &is_valid);
+    if (!is_valid) return VERIFY_BAD_SIGNATURE;
+
+    // Ogni azione del batch porta la firma del proprio mittente
+    if (curr->type == ACT_BATCH) {
+        for (int i = 0; i < curr->data.batch.count; i++) {
+            if (!action_verify(&curr->actions[i], curr->prev_hash)) return VERIFY_BAD_ACTION_SIGNATURE;
+        }
+    }
+
+    // Un timestamp all'indietro (o nel futuro) allungherebbe a piacere la
+    // finestra del retarget. Il ledger su disco è l'unico ingresso dei blocchi.
+    if (curr->timestamp < prev->timestamp || curr->timestamp - time(NULL) > POW_MAX_FUTURE_DRIFT) return VERIFY_BAD_TIMESTAMP;
+
+    // Un blocco legacy (difficoltà non registrata) può seguire solo un altro
+    // blocco legacy; gli altri devono dichiarare la difficoltà del retarget.
+    if (curr->difficulty == 0 ? prev->difficulty != 0 : curr->difficulty != pow_next_difficulty(prev, window)) {
+        return VERIFY_BAD_DIFFICULTY;
+    }
+    if (!pow_hash_meets(curr->curr_hash, pow_block_bits(curr))) return VERIFY_POW_FAILED;
+    return VERIFY_OK;
+}
+
+// ---------------------------------------------------------
+// POOL DI VERIFICA
+// ---------------------------------------------------------
+typedef struct {
+    const LedgerView *view;
+    const size_t *offsets;
+    const ChainCheckpoint *cp;
+    atomic_long next_chunk;
+    atomic_long first_fail;      // Posizione del primo blocco fallito (LONG_MAX = nessuno)
+    VerifyResult fail_reason;
+    pthread_mutex_t lock;
+} VerifyJob;
+
+static void record_failure(VerifyJob *job, long pos, VerifyResult reason) {
+    pthread_mutex_lock(&job->lock);
+    if (pos < atomic_load(&job->first_fail)) {
+        atomic_store(&job->first_fail, pos);
+        job->fail_reason = reason;
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+// I chunk vengono presi in ordine crescente: appena un chunk parte oltre il
+// primo errore noto, nessun chunk successivo può abbassarlo e il worker esce.
+// Dentro il chunk i blocchi si decodificano a gruppi di SHA256_MAX_LANES, i
+// loro preimage passano insieme da sha256_many e poi si verificano in ordine.
+static void *verify_worker(void *arg) {
+    VerifyJob *job = arg;
+    const long count = job->view->count;
+    // ring[0] è il predecessore del gruppo, ring[1..n] i blocchi del gruppo
+    Block *ring[SHA256_MAX_LANES + 1];
+    Block *storage = safe_zalloc(sizeof(Block) * (SHA256_MAX_LANES + 2));
+    Block *window = &storage[SHA256_MAX_LANES + 1];
+    char (*raw)[2048] = safe_zalloc(sizeof(*raw) * SHA256_MAX_LANES);
+    for (int i = 0; i <= SHA256_MAX_LANES; i++) ring[i] = &storage[i];
+
+    while (1) {
+        long start = atomic_fetch_add(&job->next_chunk, 1) * VERIFY_CHUNK_SIZE;
+        if (start >= count || start >= atomic_load(&job->first_fail)) break;
+
+        long end = (start + VERIFY_CHUNK_SIZE < count) ? start + VERIFY_CHUNK_SIZE : count;
+        long first = (start == 0) ? 1 : start; // Il genesi non ha predecessore
+
+        if (!ledger_read_block_at(job->view, job->offsets[first - 1], ring[0])) {
+            record_failure(job, first - 1, VERIFY_UNDECODABLE);
+            continue;
+        }
+        // Il genesi non passa da verify_block: la sua altezza si controlla qui
+        if (start == 0 && ring[0]->index != 0) {
+            record_failure(job, 0, VERIFY_BAD_INDEX);
+            continue;
+        }
+        for (long pos = first; pos < end && pos < atomic_load(&job->first_fail); ) {
+            const uint8_t *msgs[SHA256_MAX_LANES];
+            size_t lens[SHA256_MAX_LANES];
+            uint8_t hashes[SHA256_MAX_LANES][HASH_SIZE];
+            int n = 0;
+
+            // Un record illeggibile chiude il gruppo: i blocchi prima di lui
+            // si verificano comunque, così l'errore riportato resta il primo.
+            while (n < SHA256_MAX_LANES && pos + n < end
+                   && ledger_read_block_at(job->view, job->offsets[pos + n], ring[n + 1])) {
+                serialize_block_content(ring[n + 1], raw[n], sizeof(raw[n]));
+                msgs[n] = (const uint8_t *)raw[n];
+                lens[n] = strlen(raw[n]);
+                n++;
+            }
+            sha256_many(NULL, msgs, lens, n, hashes);
+
+            VerifyResult r = VERIFY_OK;
+            int i = 0;
+            for (; i < n && r == VERIFY_OK; i++) {
+                const Block *curr = ring[i + 1];
+                const Block *wp = NULL;
+                long wpos = pos + i - POW_RETARGET_INTERVAL; // Per posizione: l'index è ancora da validare
+                if ((pos + i) % POW_RETARGET_INTERVAL == 0 && wpos >= 0
+                    && ledger_read_block_at(job->view, job->offsets[wpos], window)) {
+                    wp = window;
+                }
+                r = verify_block(ring[i], curr, pos + i, wp, job->cp, hashes[i]);
+            }
+            if (r == VERIFY_OK && n < SHA256_MAX_LANES && pos + n < end) {
+                r = VERIFY_UNDECODABLE; // Il record pos + n
+                i++;
+            }
+            if (r != VERIFY_OK) {
+                record_failure(job, pos + i - 1, r);
+                break;
+            }
+            // L'ultimo blocco del gruppo diventa il predecessore del prossimo
+            Block *tmp = ring[0];
+            ring[0] = ring[n];
+            ring[n] = tmp;
+            pos += n;
+        }
+    }
+    for (int i = 0; i < SHA256_MAX_LANES + 2; i++) block_release(&storage[i]);
+    free(raw);
+    free(storage);
+    return NULL;
+}
+
+// Stampa l'allarme del primo blocco fallito (come la vecchia verifica sequenziale)
+static void report_failure(const VerifyJob *job, long pos) {
+    Block prev = {0}, curr = {0};
+    if (!ledger_read_block_at(job->view, job->offsets[pos], &curr)) {
+        fprintf(stderr, "[ALERT] UNDECODABLE RECORD at position %ld!\n", pos);
+        block_release(&curr);
+        return;
+    }
+    switch (job->fail_reason) {
+        case VERIFY_BROKEN_LINK:
+            if (pos > 0 && ledger_read_block_at(job->view, job->offsets[pos - 1], &prev)) integrity_check(&prev, &curr);
+            break;
+        case VERIFY_TAMPERED:
+            fprintf(stderr, "[ALERT] DATA TAMPERING at Block #%d!\n", curr.index);
+            break;
+        case VERIFY_BAD_SIGNATURE:
+            fprintf(stderr, "[ALERT] INVALID SIGNATURE at Block #%d!\n", curr.index);
+            break;
+        case VERIFY_POW_FAILED:
+            fprintf(stderr, "[ALERT] POW FAILED at Block #%d! Hash has fewer than %d leading zero bits.\n", curr.index, pow_block_bits(&curr));
+            break;
+        case VERIFY_BAD_BATCH:
+            fprintf(stderr, "[ALERT] MALFORMED BATCH at Block #%d (Merkle root mismatch)!\n", curr.index);
+            break;
+        case VERIFY_BAD_ACTION_SIGNATURE:
+            fprintf(stderr, "[ALERT] INVALID ACTION SIGNATURE in Batch #%d!\n", curr.index);
+            break;
+        case VERIFY_BAD_DIFFICULTY:
+            fprintf(stderr, "[ALERT] WRONG DIFFICULTY at Block #%d (%d bit)!\n", curr.index, pow_block_bits(&curr));
+            break;
+        case VERIFY_CHECKPOINT_MISMATCH:
+            fprintf(stderr, "[ALERT] CHECKPOINT MISMATCH at Block #%d!\n", curr.index);
+            break;
+        case VERIFY_BAD_TIMESTAMP:
+            fprintf(stderr, "[ALERT] TIMESTAMP OUT OF RANGE at Block #%d (before parent or in the future)!\n", curr.index);
+            break;
+        case VERIFY_BAD_INDEX:
+            fprintf(stderr, "[ALERT] INDEX DISCONTINUITY at position %ld (block claims #%d)!\n", pos, curr.index);
+            break;
+        default:
+            fprintf(stderr, "[ALERT] UNDECODABLE RECORD after Block #%d!\n", curr.index);
+            break;
+    }
+    block_release(&prev);
+    block_release(&curr);
+}
+
+static int thread_count(long count) {
+    long n = verify_threads > 0 ? verify_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    long chunks = (count + VERIFY_CHUNK_SIZE - 1) / VERIFY_CHUNK_SIZE;
+    if (n > VERIFY_MAX_THREADS) n = VERIFY_MAX_THREADS;
+    if (n > chunks) n = chunks;
+    return n < 1 ? 1 : (int)n;
+}
+
+// Ritorna 1 se valida, 0 se corrotta, -1 se il checkpoint non appartiene a questa chain
+static int verify_chain_from(const LedgerView *view, const ChainCheckpoint *cp) {
+    VerifyJob job = { .view = view, .cp = cp, .fail_reason = VERIFY_OK };
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.first_fail, LONG_MAX);
+    pthread_mutex_init(&job.lock, NULL);
+    job.offsets = ledger_view_offsets(view);
+
+    int n_threads = thread_count(view->count);
+    pthread_t workers[VERIFY_MAX_THREADS];
+    int started = 0;
+
+    for (int i = 1; i < n_threads; i++) {
+        if (pthread_create(&workers[started], NULL, verify_worker, &job) == 0) started++;
+    }
+    verify_worker(&job); // Anche il thread chiamante lavora
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+
+    long fail = atomic_load(&job.first_fail);
+    int rc = 1;
+    if (fail != LONG_MAX) {
+        report_failure(&job, fail);
+        rc = (job.fail_reason == VERIFY_CHECKPOINT_MISMATCH) ? -1 : 0;
+    } else {
+        Block tip = {0};
+        printf("[SECURITY] Chain Verified. %ld blocks checked (%d thread). Status: SECURE.\n", view->count, started + 1);
+        if (ledger_read_block_at(view, view->last_offset, &tip)) checkpoint_save(CHECKPOINT_FILE, (int)(view->count - 1), tip.curr_hash);
+        block_release(&tip);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    free((void *)job.offsets);
+    return rc;
+}
+
+// ---------------------------------------------------------
+// VERIFICA CATENA
+// ---------------------------------------------------------
+int verifyFullChain(const LedgerView *view) {
+    if (!view || view->count == 0) return 0;
+
+    ChainCheckpoint cp;
+    printf("\n[SECURITY] Avvio verifica integrità blockchain...\n");
+
+    // Il checkpoint vale solo se cade dentro la chain attuale
+    if (!verify_paranoid && checkpoint_load(CHECKPOINT_FILE, &cp) && cp.height < view->count) {
+        printf("[SECURITY] ⚡ Checkpoint #%d: firme e PoW già verificate fino a quell'altezza.\n", cp.height);
+        int rc = verify_chain_from(view, &cp);
+        if (rc >= 0) return rc;
+        // La chain non è quella del checkpoint: si ripete la verifica completa
+        printf("[SECURITY] Checkpoint non valido per questa chain. Verifica completa...\n");
+    } else if (verify_paranoid) {
+        printf("[SECURITY] 🛡️ Modalità paranoid: verifica completa di ogni firma.\n");
+    }
+    return verify_chain_from(view, NULL) == 1;
+}
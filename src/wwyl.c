@@ -4,9 +4,32 @@
 #include "wwyl_config.h" 
 #include "user.h"
 #include "post_state.h"
+#include "ledger.h"
+#include "snapshot.h"
+#include "verify.h"
+#include "miner.h"
+#include "batch.h"
+#include "mempool.h"
+#include "mmr.h"
+#include "hex.h"
 
 WalletStore global_wallet;
 int current_user_idx = -1;
+#ifndef WWYL_NO_MAIN
+// Sessioni di firma delle identità del wallet: aperte al login, chiuse all'uscita
+static SignSession *wallet_sessions[10];
+
+// ---------------------------------------------------------
+// SESSIONE DI FIRMA DI UN'IDENTITÀ
+// ---------------------------------------------------------
+static SignSession *wallet_session(int idx) {
+    if (!wallet_sessions[idx]) {
+        wallet_sessions[idx] = sign_session_new(global_wallet.entries[idx].priv);
+        if (!wallet_sessions[idx]) printf("[WALLET] ❌ Chiave privata non valida per '%s'.\n", global_wallet.entries[idx].username);
+    }
+    return wallet_sessions[idx];
+}
+#endif
 
 // ---------------------------------------------------------
 // SALVA WALLET SU DISCO
@@ -51,11 +74,14 @@ int getBlockId(Block block) {
 // ---------------------------------------------------------
 // VERIFICA INTEGRITÀ LINK TRA DUE BLOCCHI
 // ---------------------------------------------------------
-int integrity_check(Block *prev, Block *curr) {
-    if (strcmp(curr->prev_hash, prev->curr_hash) != 0) {
+int integrity_check(const Block *prev, const Block *curr) {
+    if (memcmp(curr->prev_hash, prev->curr_hash, HASH_SIZE) != 0) {
+        char expected[HASH_LEN], found[HASH_LEN];
+        hex_encode(prev->curr_hash, HASH_SIZE, expected);
+        hex_encode(curr->prev_hash, HASH_SIZE, found);
         fprintf(stderr, "[ALERT] BROKEN CHAIN at Block #%d!\n", curr->index);
-        fprintf(stderr, "        Expected Prev: %s\n", prev->curr_hash);
-        fprintf(stderr, "        Found Prev:    %s\n", curr->prev_hash);
+        fprintf(stderr, "        Expected Prev: %s\n", expected);
+        fprintf(stderr, "        Found Prev:    %s\n", found);
         return 0; // Fail
     }
     return 1; // Success
@@ -76,8 +102,10 @@ static void sanitize_string(char *str) {
 // ---------------------------------------------------------
 // HELPER: Serializzazione per Hashing
 // ---------------------------------------------------------
-void serialize_block_content(const Block *block, char *buffer, size_t size) {
-    char payload_str[MAX_CONTENT_LEN + 20]; 
+// Preimage: "index:timestamp:prev_hash:sender_pubkey:type:nonce:payload".
+// Gli hash binari entrano nel preimage come hex minuscolo (formato originale).
+// Per ACT_BATCH il payload è "count:merkle_root".
+void serialize_action_payload(ActionType type, const ActionPayload *data, char *payload_str, size_t payload_size) {
     char temp_content[MAX_CONTENT_LEN];
     char temp_username[32];
     char temp_bio[64];
@@ -86,69 +114,88 @@ void serialize_block_content(const Block *block, char *buffer, size_t size) {
     char temp_hash[HASH_LEN];
     char temp_salt[32];
     
-    switch (block->type) {
+    switch (type) {
         case ACT_POST_CONTENT:
-            snprintf(temp_content, sizeof(temp_content), "%.*s", MAX_CONTENT_LEN - 1, block->data.post.content);
+            snprintf(temp_content, sizeof(temp_content), "%.*s", MAX_CONTENT_LEN - 1, data->post.content);
             sanitize_string(temp_content);
-            snprintf(payload_str, sizeof(payload_str), "%s", temp_content);
+            snprintf(payload_str, payload_size, "%s", temp_content);
             break;
         case ACT_REGISTER_USER:
-            snprintf(temp_username, sizeof(temp_username), "%.*s", 31, block->data.registration.username);
-            snprintf(temp_bio, sizeof(temp_bio), "%.*s", 63, block->data.registration.bio);
-            snprintf(temp_pic, sizeof(temp_pic), "%.*s", 127, block->data.registration.pic_url);
+            snprintf(temp_username, sizeof(temp_username), "%.*s", 31, data->registration.username);
+            snprintf(temp_bio, sizeof(temp_bio), "%.*s", 63, data->registration.bio);
+            snprintf(temp_pic, sizeof(temp_pic), "%.*s", 127, data->registration.pic_url);
             sanitize_string(temp_username);
             sanitize_string(temp_bio);
             sanitize_string(temp_pic);
-            snprintf(payload_str, sizeof(payload_str), "%s:%s:%s", temp_username, temp_bio, temp_pic);
+            snprintf(payload_str, payload_size, "%s:%s:%s", temp_username, temp_bio, temp_pic);
             break;
         case ACT_POST_COMMENT:
-            snprintf(temp_content, sizeof(temp_content), "%.*s", MAX_CONTENT_LEN - 1, block->data.comment.content);
+            snprintf(temp_content, sizeof(temp_content), "%.*s", MAX_CONTENT_LEN - 1, data->comment.content);
             sanitize_string(temp_content);
-            snprintf(payload_str, sizeof(payload_str), "%d:%s",
-                     block->data.comment.target_post_id,
+            snprintf(payload_str, payload_size, "%d:%s",
+                     data->comment.target_post_id,
                      temp_content);
             break;
         case ACT_VOTE_COMMIT:
-            snprintf(temp_hash, sizeof(temp_hash), "%.*s", HASH_LEN - 1, block->data.commit.vote_hash);
-            sanitize_string(temp_hash);
-            snprintf(payload_str, sizeof(payload_str), "%d:%s",
-                     block->data.commit.target_post_id,
+            hex_encode(data->commit.vote_hash, HASH_SIZE, temp_hash);
+            snprintf(payload_str, payload_size, "%d:%s",
+                     data->commit.target_post_id,
                      temp_hash);
             break;
         case ACT_VOTE_REVEAL:
-            snprintf(temp_salt, sizeof(temp_salt), "%.*s", 31, block->data.reveal.salt_secret);
+            snprintf(temp_salt, sizeof(temp_salt), "%.*s", 31, data->reveal.salt_secret);
             sanitize_string(temp_salt);
-            snprintf(payload_str, sizeof(payload_str), "%d:%d:%s",      
-                     block->data.reveal.target_post_id,
-                     block->data.reveal.vote_value,
+            snprintf(payload_str, payload_size, "%d:%d:%s",      
+                     data->reveal.target_post_id,
+                     data->reveal.vote_value,
                      temp_salt);
             break;
         case ACT_FOLLOW_USER:
-            snprintf(temp_pubkey, sizeof(temp_pubkey), "%.*s", SIGNATURE_LEN - 1, block->data.follow.target_user_pubkey);
+            snprintf(temp_pubkey, sizeof(temp_pubkey), "%.*s", SIGNATURE_LEN - 1, data->follow.target_user_pubkey);
             sanitize_string(temp_pubkey);
-            snprintf(payload_str, sizeof(payload_str), "%s", temp_pubkey);
+            snprintf(payload_str, payload_size, "%s", temp_pubkey);
             break;
         case ACT_POST_FINALIZE:
-            snprintf(payload_str, sizeof(payload_str), "%d", block->data.finalize.target_post_id);
+            snprintf(payload_str, payload_size, "%d", data->finalize.target_post_id);
             break;
         case ACT_TRANSFER:
-            snprintf(temp_pubkey, sizeof(temp_pubkey), "%.*s", SIGNATURE_LEN - 1, block->data.transfer.target_pubkey);
+            snprintf(temp_pubkey, sizeof(temp_pubkey), "%.*s", SIGNATURE_LEN - 1, data->transfer.target_pubkey);
             sanitize_string(temp_pubkey);
-            snprintf(payload_str, sizeof(payload_str), "%s:%d", temp_pubkey, block->data.transfer.amount);
+            snprintf(payload_str, payload_size, "%s:%d", temp_pubkey, data->transfer.amount);
+            break;
+        case ACT_BATCH:
+            hex_encode(data->batch.merkle_root, HASH_SIZE, temp_hash);
+            snprintf(payload_str, payload_size, "%d:%s", data->batch.count, temp_hash);
             break;
         default:
-            snprintf(payload_str, sizeof(payload_str), "UNKNOWN");
+            snprintf(payload_str, payload_size, "UNKNOWN");
             break;
     }
+}
 
-    int len = snprintf(buffer, size, "%u:%ld:%s:%s:%d:%d:%s", // <--- Aggiungi formato
+// Parte costante del preimage durante il mining (tutto ciò che precede il nonce).
+// La difficoltà entra nel preimage come "d<bit>:" solo se registrata: i blocchi
+// legacy mantengono il preimage (e quindi l'hash) originale.
+static int serialize_block_prefix(const Block *block, char *buffer, size_t size) {
+    char prev_hex[HASH_LEN];
+    char diff_str[8] = "";
+    hex_encode(block->prev_hash, HASH_SIZE, prev_hex);
+    if (block->difficulty) snprintf(diff_str, sizeof(diff_str), "d%u:", block->difficulty);
+    return snprintf(buffer, size, "%u:%ld:%s:%s:%d:%s",
         block->index,
         block->timestamp,
-        block->prev_hash,
+        prev_hex,
         block->sender_pubkey,
         block->type,
-        block->nonce,  
-        payload_str);
+        diff_str);
+}
+
+void serialize_block_content(const Block *block, char *buffer, size_t size) {
+    char payload_str[MAX_CONTENT_LEN + 20];
+    serialize_action_payload(block->type, &block->data, payload_str, sizeof(payload_str));
+    int prefix_len = serialize_block_prefix(block, buffer, size);
+    int len = (prefix_len < 0 || (size_t)prefix_len >= size) ? prefix_len
+            : prefix_len + snprintf(buffer + prefix_len, size - prefix_len, "%d:%s", block->nonce, payload_str);
         
     if (len < 0 || (size_t)len >= size) {
        // Ora puoi usare return invece di fatal_error per non crashare
@@ -156,6 +203,39 @@ void serialize_block_content(const Block *block, char *buffer, size_t size) {
     }
 }
 
+// ---------------------------------------------------------
+// DIFFICOLTÀ PROOF-OF-WORK
+// ---------------------------------------------------------
+int pow_block_bits(const Block *block) {
+    return block->difficulty ? block->difficulty : POW_LEGACY_BITS;
+}
+
+// Difficoltà del blocco che segue 'prev'. window_start è il blocco di altezza
+// (prev->index + 1 - POW_RETARGET_INTERVAL), richiesto solo alle altezze di
+// retarget: la finestra copre i tempi tra window_start e prev.
+int pow_next_difficulty(const Block *prev, const Block *window_start) {
+    int bits = pow_block_bits(prev);
+    int next = prev->index + 1;
+    if (next % POW_RETARGET_INTERVAL != 0 || !window_start) return bits;
+
+    long expected = (long)(POW_RETARGET_INTERVAL - 1) * POW_TARGET_BLOCK_TIME;
+    long actual = (long)(prev->timestamp - window_start->timestamp);
+    if (actual < expected / 2) bits++;
+    else if (actual > expected * 2) bits--;
+
+    if (bits < POW_MIN_BITS) bits = POW_MIN_BITS;
+    if (bits > POW_MAX_BITS) bits = POW_MAX_BITS;
+    return bits;
+}
+
+int pow_hash_meets(const uint8_t *hash, int bits) {
+    int i = 0;
+    for (; bits >= 8; bits -= 8) {
+        if (hash[i++] != 0) return 0;
+    }
+    return bits == 0 || (hash[i] >> (8 - bits)) == 0;
+}
+
 // ---------------------------------------------------------
 // CREAZIONE DEL BLOCCO GENESI
 // ---------------------------------------------------------
@@ -164,8 +244,8 @@ Block *create_genesis_block() {
     block->index = 0;
     block->timestamp = time(NULL);
     block->type = ACT_REGISTER_USER;
-    memset(block->prev_hash, '0', 64);
-    block->prev_hash[64] = '\0';
+    block->difficulty = POW_INITIAL_BITS;
+    memset(block->prev_hash, 0, HASH_SIZE); // "000...0" nel preimage
 
     if (snprintf(block->sender_pubkey, sizeof(block->sender_pubkey), "%s", GOD_PUB_KEY) >= (int)sizeof(block->sender_pubkey)) {
         fprintf(stderr, "[WARN] Genesis Public Key troncata!\n");
@@ -176,12 +256,16 @@ Block *create_genesis_block() {
     snprintf(block->data.registration.pic_url, sizeof(block->data.registration.pic_url), "founder.png");
 
     char raw_data_buffer[2048];
+    char hash_hex[HASH_LEN];
+    char sig_hex[SIG_SIZE * 2 + 1];
     serialize_block_content(block, raw_data_buffer, sizeof(raw_data_buffer));
-    sha256_hash(raw_data_buffer, strlen(raw_data_buffer), block->curr_hash);
-    ecdsa_sign(GOD_PRIV_KEY, block->curr_hash, block->signature);
+    sha256_raw(raw_data_buffer, strlen(raw_data_buffer), block->curr_hash);
+    hex_encode(block->curr_hash, HASH_SIZE, hash_hex);
+    ecdsa_sign(GOD_PRIV_KEY, hash_hex, block->signature);
+    hex_encode(block->signature, SIG_SIZE, sig_hex);
 
     printf("[GENESIS] Profile Created for: %.16s...\n", block->sender_pubkey);
-    printf("[GENESIS] Signature: %.16s...\n", block->signature);
+    printf("[GENESIS] Signature: %.16s...\n", sig_hex);
 
     return block;
 }
@@ -203,13 +287,24 @@ void print_block(const Block *block) {
         printf("[DEBUG] Block is NULL\n");
         return;
     }
+    char sig_hex[SIG_SIZE * 2 + 1], prev_hex[HASH_LEN], curr_hex[HASH_LEN];
+    hex_encode(block->signature, SIG_SIZE, sig_hex);
+    hex_encode(block->prev_hash, HASH_SIZE, prev_hex);
+    hex_encode(block->curr_hash, HASH_SIZE, curr_hex);
+
     printf("=== Block #%d Details ===\n", block->index);
     printf("# Timestamp: %ld\n", block->timestamp);
     printf("# Action Type: %d\n", block->type);
     printf("# Sender PubKey: %s\n", block->sender_pubkey);
-    printf("# Signature: %s\n", block->signature);
-    printf("# Previous Hash: %s\n", block->prev_hash);
-    printf("# Current Hash: %s\n", block->curr_hash);
+    printf("# Signature: %s\n", sig_hex);
+    printf("# Previous Hash: %s\n", prev_hex);
+    printf("# Current Hash: %s\n", curr_hex);
+    printf("# Difficulty: %d bit%s\n", pow_block_bits(block), block->difficulty ? "" : " (legacy)");
+    if (block->type == ACT_BATCH) {
+        char root_hex[HASH_LEN];
+        hex_encode(block->data.batch.merkle_root, HASH_SIZE, root_hex);
+        printf("# Batch: %d azioni | Merkle Root: %s\n", block->data.batch.count, root_hex);
+    }
     
     // (Opzionale: puoi aggiungere lo switch case per stampare il payload specifico qui)
     
@@ -217,143 +312,199 @@ void print_block(const Block *block) {
 }
 
 // ---------------------------------------------------------
-// MINE NEW BLOCK
+// COPIA PAYLOAD
 // ---------------------------------------------------------
-Block *mine_new_block(Block *prev_block, ActionType type, const void *payload_data, const char *sender_pubkey, const char *sender_privkey) {
-    if (!prev_block) { fatal_error("Previous block is NULL!"); }
-    
-    Block *new_block = (Block *)safe_zalloc(sizeof(Block));
-    new_block->index = prev_block->index + 1;
-    new_block->timestamp = time(NULL);
-    snprintf(new_block->prev_hash, sizeof(new_block->prev_hash), "%s", prev_block->curr_hash);
-    new_block->type = type;
-
+// Copia il payload del chiamante (la struct Payload* del tipo) nella union
+void action_set_payload(ActionPayload *dst, ActionType type, const void *payload_data) {
     switch (type) {
     case ACT_POST_CONTENT:
-        snprintf(new_block->data.post.content, MAX_CONTENT_LEN, "%s", ((PayloadPost *)payload_data)->content);
+        snprintf(dst->post.content, MAX_CONTENT_LEN, "%s", ((PayloadPost *)payload_data)->content);
         break;
     case ACT_POST_COMMENT:
-        new_block->data.comment.target_post_id = ((PayloadComment *)payload_data)->target_post_id;
-        snprintf(new_block->data.comment.content, MAX_CONTENT_LEN, "%s", ((PayloadComment *)payload_data)->content);
+        dst->comment.target_post_id = ((PayloadComment *)payload_data)->target_post_id;
+        snprintf(dst->comment.content, MAX_CONTENT_LEN, "%s", ((PayloadComment *)payload_data)->content);
         break;
     case ACT_VOTE_COMMIT:
-        new_block->data.commit.target_post_id = ((PayloadCommit *)payload_data)->target_post_id;
-        snprintf(new_block->data.commit.vote_hash, HASH_LEN, "%s", ((PayloadCommit *)payload_data)->vote_hash);
+        dst->commit.target_post_id = ((PayloadCommit *)payload_data)->target_post_id;
+        memcpy(dst->commit.vote_hash, ((PayloadCommit *)payload_data)->vote_hash, HASH_SIZE);
         break;
     case ACT_VOTE_REVEAL:
-        new_block->data.reveal.target_post_id = ((PayloadReveal *)payload_data)->target_post_id;
-        new_block->data.reveal.vote_value = ((PayloadReveal *)payload_data)->vote_value;
-        snprintf(new_block->data.reveal.salt_secret, sizeof(new_block->data.reveal.salt_secret), "%s", ((PayloadReveal *)payload_data)->salt_secret);
+        dst->reveal.target_post_id = ((PayloadReveal *)payload_data)->target_post_id;
+        dst->reveal.vote_value = ((PayloadReveal *)payload_data)->vote_value;
+        snprintf(dst->reveal.salt_secret, sizeof(dst->reveal.salt_secret), "%s", ((PayloadReveal *)payload_data)->salt_secret);
         break;
     case ACT_FOLLOW_USER:
-        snprintf(new_block->data.follow.target_user_pubkey, SIGNATURE_LEN, "%s", ((PayloadFollow *)payload_data)->target_user_pubkey);
+        snprintf(dst->follow.target_user_pubkey, SIGNATURE_LEN, "%s", ((PayloadFollow *)payload_data)->target_user_pubkey);
         break;
     case ACT_REGISTER_USER:
-        snprintf(new_block->data.registration.username, 32, "%s", ((PayloadRegister *)payload_data)->username);
-        snprintf(new_block->data.registration.bio, 64, "%s", ((PayloadRegister *)payload_data)->bio);
-        snprintf(new_block->data.registration.pic_url, 128, "%s", ((PayloadRegister *)payload_data)->pic_url);
+        snprintf(dst->registration.username, 32, "%s", ((PayloadRegister *)payload_data)->username);
+        snprintf(dst->registration.bio, 64, "%s", ((PayloadRegister *)payload_data)->bio);
+        snprintf(dst->registration.pic_url, 128, "%s", ((PayloadRegister *)payload_data)->pic_url);
         break;
     case ACT_POST_FINALIZE:
-        new_block->data.finalize.target_post_id = ((PayloadFinalize *)payload_data)->target_post_id;
+        dst->finalize.target_post_id = ((PayloadFinalize *)payload_data)->target_post_id;
         break;
     case ACT_TRANSFER:
-        snprintf(new_block->data.transfer.target_pubkey, SIGNATURE_LEN, "%s", ((PayloadTransfer *)payload_data)->target_pubkey);
-        new_block->data.transfer.amount = ((PayloadTransfer *)payload_data)->amount;
+        snprintf(dst->transfer.target_pubkey, SIGNATURE_LEN, "%s", ((PayloadTransfer *)payload_data)->target_pubkey);
+        dst->transfer.amount = ((PayloadTransfer *)payload_data)->amount;
         break;
     default:
-        printf("[WARN] Unknown block type during mining.\n");
+        printf("[WARN] Unknown action type %d.\n", type);
         break;
     }
+}
+
+// ---------------------------------------------------------
+// FASI DEL MINING
+// ---------------------------------------------------------
+// Costruzione -> block_prepare (difficoltà, legge il ledger) -> block_solve
+// (PoW e firma, nessuno stato condiviso) -> block_commit (aggancio e ledger).
+// Il miner in background tiene il lock della chain solo nella prima e
+// nell'ultima fase. Nessuna fase libera il blocco: ci pensa il chiamante.
+static Block *block_alloc(const Block *prev_block, ActionType type, const char *sender_pubkey) {
+    if (!prev_block) { fatal_error("Previous block is NULL!"); }
+
+    Block *new_block = (Block *)safe_zalloc(sizeof(Block));
+    new_block->index = prev_block->index + 1;
+    new_block->timestamp = time(NULL);
+    if (new_block->timestamp < prev_block->timestamp) new_block->timestamp = prev_block->timestamp; // Orologio tornato indietro
+    memcpy(new_block->prev_hash, prev_block->curr_hash, HASH_SIZE);
+    new_block->type = type;
 
     if (snprintf(new_block->sender_pubkey, sizeof(new_block->sender_pubkey), "%s", sender_pubkey) >= (int)sizeof(new_block->sender_pubkey)) {
         fprintf(stderr, "[WARN] Sender Public Key troncata!\n");
     }
+    return new_block;
+}
+
+Block *block_new_action(const Block *prev_block, ActionType type, const void *payload_data, const char *sender_pubkey) {
+    Block *new_block = block_alloc(prev_block, type, sender_pubkey);
+    action_set_payload(&new_block->data, type, payload_data);
+    return new_block;
+}
+
+// Le azioni arrivano già firmate dai mittenti su prev_block->curr_hash;
+// il miner firma solo l'header (che contiene la Merkle root).
+Block *block_new_batch(const Block *prev_block, const Action *actions, int count, const char *miner_pubkey) {
+    if (count < 1 || count > MAX_BLOCK_ACTIONS) return NULL;
 
+    Block *new_block = block_alloc(prev_block, ACT_BATCH, miner_pubkey);
+    new_block->actions = (Action *)safe_zalloc((size_t)count * sizeof(Action));
+    memcpy(new_block->actions, actions, (size_t)count * sizeof(Action));
+    new_block->data.batch.count = count;
+    if (!batch_merkle_root(new_block, new_block->data.batch.merkle_root)) {
+        fprintf(stderr, "[BATCH] ❌ Batch non valido (post multipli, duplicati o azioni annidate).\n");
+        block_free(new_block);
+        return NULL;
+    }
+    return new_block;
+}
+
+// Difficoltà: quella del blocco precedente, ricalcolata alle altezze di retarget
+int block_prepare(const Block *prev_block, Block *new_block) {
+    if (new_block->timestamp < prev_block->timestamp || new_block->timestamp - time(NULL) > POW_MAX_FUTURE_DRIFT) {
+        fprintf(stderr, "[MINER] ❌ Timestamp %ld del blocco #%d fuori intervallo (padre %ld).\n",
+                (long)new_block->timestamp, new_block->index, (long)prev_block->timestamp);
+        return 0;
+    }
+    Block window_start = {0};
+    const Block *window = NULL;
+    if (new_block->index % POW_RETARGET_INTERVAL == 0) {
+        if (!get_block_by_index(new_block->index - POW_RETARGET_INTERVAL, &window_start)) {
+            fprintf(stderr, "[MINER] ❌ Blocco #%d non leggibile per il retarget.\n", new_block->index - POW_RETARGET_INTERVAL);
+            block_release(&window_start);
+            return 0;
+        }
+        window = &window_start;
+    }
+    new_block->difficulty = (uint8_t)pow_next_difficulty(prev_block, window);
+    block_release(&window_start);
+    if (new_block->difficulty != pow_block_bits(prev_block)) {
+        node_printf("[MINER] 🎯 Retarget al blocco #%d: difficoltà %d → %d bit.\n",
+                    new_block->index, pow_block_bits(prev_block), new_block->difficulty);
+    }
+    return 1;
+}
+
+int block_solve(Block *new_block, SignSession *signer) {
     char raw_data_buffer[2048];
+    char hash_hex[HASH_LEN];
+
+    // Proof-of-Work: hash con almeno 'difficulty' bit zero iniziali.
+    // Tra un tentativo e l'altro cambia solo il nonce: il prefisso costante
+    // del preimage viene assorbito una volta sola (midstate) e per ogni nonce
+    // si hashano solo "nonce:payload", in parallelo su miner_threads thread.
+    char prefix[1024];
+    char suffix[MAX_CONTENT_LEN + 24];
+    serialize_block_prefix(new_block, prefix, sizeof(prefix));
+    suffix[0] = ':';
+    serialize_action_payload(new_block->type, &new_block->data, suffix + 1, sizeof(suffix) - 1);
+
+    if (!miner_search(prefix, strlen(prefix), suffix, strlen(suffix), new_block->difficulty,
+                      &new_block->nonce, new_block->curr_hash)) {
+        fprintf(stderr, "[MINER] ❌ Spazio dei nonce esaurito per il blocco #%d.\n", new_block->index);
+        return 0;
+    }
+
+    // Controllo incrociato con il preimage canonico usato dalla verifica
+    uint8_t check[HASH_SIZE];
+    serialize_block_content(new_block, raw_data_buffer, sizeof(raw_data_buffer));
+    sha256_raw(raw_data_buffer, strlen(raw_data_buffer), check);
+    if (memcmp(check, new_block->curr_hash, HASH_SIZE) != 0) {
+        fprintf(stderr, "[ALERT] Mining midstate diverge dal preimage canonico!\n");
+        return 0;
+    }
     
-    // Proof-of-Work Mining Loop
-    long nonce = 0;
-    char hash_check[3];
-    
-    do {
-        new_block->nonce = nonce++;
-        serialize_block_content(new_block, raw_data_buffer, sizeof(raw_data_buffer));
-        sha256_hash(raw_data_buffer, strlen(raw_data_buffer), new_block->curr_hash);
-        strncpy(hash_check, new_block->curr_hash, 2);
-        hash_check[2] = '\0';
-    } while (strcmp(hash_check, "00") != 0);
-    
-    ecdsa_sign(sender_privkey, new_block->curr_hash, new_block->signature);
+    // Si firma l'hash in hex, come nel formato originale
+    hex_encode(new_block->curr_hash, HASH_SIZE, hash_hex);
+    sign_session_sign(signer, hash_hex, new_block->signature);
+    return 1;
+}
 
+int block_commit(Block *prev_block, Block *new_block) {
     prev_block->next = new_block;
-    printf("[MINED] Block #%d (Type: %d) mined by %.10s...\n", new_block->index, new_block->type, new_block->sender_pubkey);
+    node_printf("[MINED] Block #%d (Type: %d) mined by %.10s...\n", new_block->index, new_block->type, new_block->sender_pubkey);
 
     if (!integrity_check(prev_block, new_block)) {
         prev_block->next = NULL; 
-        free(new_block);         
-        return NULL;             
+        return 0;
     }
 
-    return new_block;
+    // Persistenza immediata: il blocco esiste solo se è finito sul ledger
+    if (!ledger_append_block(new_block)) {
+        prev_block->next = NULL;
+        return 0;
+    }
+    // L'accumulatore è derivato: se resta indietro lo ricostruisce mmr_open
+    if (!mmr_append(new_block->curr_hash)) {
+        fprintf(stderr, "[MMR] ⚠️ Accumulatore non aggiornato per il blocco #%d.\n", new_block->index);
+    }
+    return 1;
 }
 
-// ---------------------------------------------------------
-// VERIFICA CATENA
-// ---------------------------------------------------------
-int verifyFullChain(Block *genesis) {
-    if (!genesis) return 0;
-    Block *prev = genesis;
-    Block *curr = genesis->next;
-    char temp_hash[HASH_LEN + 1];
-    char raw_buffer[2048];
-    int count = 1;
-    int is_valid = 0;
-
-    printf("\n[SECURITY] Avvio verifica integrità blockchain...\n");
-    while (curr != NULL) {
-        if (integrity_check(prev, curr) == 0) return 0;
-        serialize_block_content(curr, raw_buffer, sizeof(raw_buffer));
-        sha256_hash(raw_buffer, strlen(raw_buffer), temp_hash);
-        if (strcmp(temp_hash, curr->curr_hash) != 0) {
-            fprintf(stderr, "[ALERT] DATA TAMPERING at Block #%d!\n", curr->index);
-            return 0; 
-        }
-        
-        // Verifica firma ECDSA
-        ecdsa_verify(curr->sender_pubkey, curr->curr_hash, curr->signature, &is_valid);
-        if (!is_valid) {
-            fprintf(stderr, "[ALERT] INVALID SIGNATURE at Block #%d!\n", curr->index);
-            return 0;
-        }
+// Le azioni di un batch vivono fuori dal Block: vanno liberate con lui
+void block_release(Block *block) {
+    free(block->actions);
+    block->actions = NULL;
+}
 
-        if (curr->index > 0 && strncmp(curr->curr_hash, "00", 2) != 0) {
-            fprintf(stderr, "[ALERT] POW FAILED at Block #%d! Hash does not start with 00.\n", curr->index);
-            return 0;
-        }
-        
-        prev = curr;
-        curr = curr->next;
-        count++;
-    }
-    printf("[SECURITY] Chain Verified. %d blocks checked. Status: SECURE.\n", count);
-    return 1; 
+void block_free(Block *block) {
+    if (!block) return;
+    block_release(block);
+    free(block);
 }
 
 // ---------------------------------------------------------
 // SALVATAGGIO
 // ---------------------------------------------------------
-void save_blockchain(Block *genesis) {
-    FILE *f = fopen("wwyl_chain.dat", "wb"); 
-    if (!f) { perror("[ERR] Cannot save blockchain"); return; }
-    Block *curr = genesis;
-    int count = 0;
-    while (curr != NULL) {
-        fwrite(curr, sizeof(Block), 1, f);
-        curr = curr->next;
-        count++;
-    }
-    fclose(f);
-    printf("[DISK] Blockchain saved! (%d blocks written)\n", count);
+// I blocchi vengono già accodati al ledger da block_commit:
+// all'uscita basta chiudere il log e spostare il checkpoint sulla coda.
+void save_blockchain(const Block *tail) {
+    // I blocchi minati in sessione sono stati prodotti (e firmati) da noi
+    if (tail) checkpoint_save(CHECKPOINT_FILE, tail->index, tail->curr_hash);
+    mmr_close();
+    ledger_close();
+    printf("[DISK] Ledger chiuso. Blockchain già persistita su '%s'.\n", CHAIN_FILE);
 }
 
 // ---------------------------------------------------------
@@ -363,40 +514,47 @@ Block *load_blockchain() {
     state_init(); 
     post_index_init();
     
-    FILE *f = fopen("wwyl_chain.dat", "rb");
-    if (!f) {
+    // Le chain salvate con il vecchio dump grezzo vengono migrate al formato compatto
+    if (ledger_detect_format(CHAIN_FILE) == LEDGER_FORMAT_LEGACY && !ledger_upgrade_legacy(CHAIN_FILE)) {
+        fatal_error("Impossibile migrare '%s' al formato v%d.", CHAIN_FILE, LEDGER_FORMAT_COMPACT);
+    }
+
+    LedgerView view;
+    int mapped = ledger_map(CHAIN_FILE, &view);
+    if (mapped < 0) {
+        fatal_error("CORRUPTED CHAIN SEGMENT ON DISK! REFUSING TO START.");
+    }
+    if (mapped == 0) {
         printf("[INFO] Nessuna chain. Creo Genesi...\n");
         Block *gen = initialize_blockchain();
-        rebuild_state_from_chain(gen); 
+        if (!ledger_open(CHAIN_FILE, CHAIN_INDEX_FILE) || !ledger_append_block(gen)) {
+            fatal_error("Impossibile scrivere il blocco genesi su '%s'.", CHAIN_FILE);
+        }
+        if (mmr_open(CHAIN_MMR_FILE, NULL)) mmr_append(gen->curr_hash);
+        state_apply_block(gen);
         return gen;
     }
+    printf("[DISK] Mapped %ld blocks (%zu bytes).\n", view.count, view.size);
 
-    printf("[DISK] Loading blockchain from file...\n");
-    Block *root = NULL;
-    Block *prev = NULL;
-    Block *curr = NULL;
-    int count = 0;
-
-    while (1) {
-        curr = (Block *)safe_zalloc(sizeof(Block));
-        if (fread(curr, sizeof(Block), 1, f) != 1) {
-            free(curr); 
-            break; 
-        }
-        curr->next = NULL; 
-        if (root == NULL) root = curr; 
-        else prev->next = curr; 
-        prev = curr;
-        count++;
+    if (!verifyFullChain(&view)) {
+        fatal_error("CORRUPTED CHAIN DETECTED ON DISK! REFUSING TO START.");
     }
-    fclose(f);
-    printf("[DISK] Loaded %d blocks.\n", count);
+    // Il ledger va aperto prima del replay: l'indice serve a validare lo snapshot e a saltare la parte già applicata
+    if (!ledger_open(CHAIN_FILE, CHAIN_INDEX_FILE)) {
+        fatal_error("Impossibile aprire il ledger '%s' in append.", CHAIN_FILE);
+    }
+    mmr_open(CHAIN_MMR_FILE, &view);
+    int snapshot_height = snapshot_load(STATE_SNAPSHOT_FILE);
+    rebuild_state_from_chain(&view, snapshot_height + 1);
 
-    if (!verifyFullChain(root)) {
-        fatal_error("CORRUPTED CHAIN DETECTED ON DISK! REFUSING TO START.");
+    // Serve in RAM solo la coda: è l'unico blocco che verrà esteso dal mining
+    Block *tail = (Block *)safe_zalloc(sizeof(Block));
+    if (!ledger_read_block_at(&view, view.last_offset, tail)) {
+        fatal_error("Impossibile leggere l'ultimo blocco del ledger.");
     }
-    rebuild_state_from_chain(root);
-    return root;
+    ledger_unmap(&view);
+
+    return tail;
 }
 
 // ---------------------------------------------------------
@@ -417,7 +575,7 @@ void free_blockchain(Block *genesis) {
     Block *curr = genesis;
     while (curr != NULL) {
         Block *next = curr->next; // Salviamo il prossimo prima di distruggere il corrente
-        free(curr);
+        block_free(curr);
         curr = next;
     }
     printf("[MEM] Blockchain memory freed successfully.\n");
@@ -441,7 +599,7 @@ void print_post_comments(int post_id) {
     printf("\n--- COMMENTI (%d) ---\n", post_id);
     CommentNode *curr = p->comments;
     while(curr) {
-        printf("@%.8s... dice: %s\n", curr->author_pubkey, curr->content);
+        printf("@%.8s... dice: %s\n", state_user_pubkey(curr->author_id), curr->content);
         curr = curr->next;
     }
 }
@@ -476,6 +634,9 @@ void print_cli() {
     printf("[13] 📖 Mostra Commenti di un Post\n");
     printf("[14] 🤝 Manda token ad un amico\n"); 
     printf("[15] 💳 Acquista Token (Simulato)\n");
+    printf("[16] 📬 Mempool (%d azioni in sospeso)\n", mempool_pending());
+    printf("[17] ⏳ Attendi il mining delle azioni in coda\n");
+    printf("[18] 🧾 Prova di inclusione di un blocco (MMR)\n");
     printf("[0] 💾 Esci e Salva Tutto\n");
     printf("> ");
 }
@@ -483,11 +644,25 @@ void print_cli() {
 // ---------------------------------------------------------
 // MAIN
 // ---------------------------------------------------------
-int main() {
+// Il benchmark (bench/wwyl_bench.c) linka il nodo con -DWWYL_NO_MAIN
+#ifndef WWYL_NO_MAIN
+int main(int argc, char *argv[]) {
+    // --paranoid: ignora il checkpoint e riverifica firme e PoW di ogni blocco
+    // --threads N: thread per la verifica della chain (default: uno per core)
+    // --miner-threads N: thread per la Proof-of-Work (default: uno per core)
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--paranoid") == 0) verify_paranoid = 1;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) verify_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--miner-threads") == 0 && i + 1 < argc) miner_threads = atoi(argv[++i]);
+    }
+
     // 1. Caricamento Blockchain (Ledger Pubblico)
+    // In RAM resta solo la coda: i nuovi blocchi minati si agganciano qui.
     Block *blockchain = load_blockchain();
     Block *last = blockchain;
     while(last->next) last = last->next;
+    // Da qui la coda della chain appartiene al miner in background
+    mempool_start(last);
 
     // 2. Caricamento Wallet (Chiavi Private Locali)
     load_wallet_from_disk();
@@ -497,7 +672,10 @@ int main() {
     int target_id, vote_val;
 
     while(1) {
+        mempool_print_notifications();
+        chain_lock();
         print_cli();
+        chain_unlock();
         if (scanf("%d", &choice) != 1) { while(getchar() != '\n'); continue; }
         getchar(); // Consuma newline
 
@@ -517,8 +695,9 @@ int main() {
                 w->registered = 0;
                 
                 // Auto-login
-                current_user_idx = global_wallet.count;
                 global_wallet.count++;
+                if (!wallet_session(global_wallet.count - 1)) break;
+                current_user_idx = global_wallet.count - 1;
                 
                 printf("🔑 Chiavi generate! Ricordati di registrarti [2].\n");
                 save_wallet_to_disk(); // Salvataggio automatico
@@ -529,7 +708,10 @@ int main() {
                 if (current_user_idx < 0) { printf("Devi prima creare un'identità o fare login.\n"); break; }
                 WalletEntry *w = &global_wallet.entries[current_user_idx];
                 
-                if (state_get_user(w->pub)) {
+                chain_lock();
+                int known = state_get_user(w->pub) != NULL;
+                chain_unlock();
+                if (known) {
                     printf("⚠️ Utente già registrato sulla blockchain.\n");
                     w->registered = 1;
                     break;
@@ -540,11 +722,12 @@ int main() {
                 snprintf(reg.bio, 64, "CLI User");
                 snprintf(reg.pic_url, 128, "default.png");
 
-                Block *b = register_user(last, &reg, w->priv, w->pub);
-                if (b) {
-                    last = b;
+                chain_lock();
+                long t = register_user(&reg, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
+                if (t > 0) {
                     w->registered = 1;
-                    printf("✅ Registrazione completata (Saldo: 0). Chiedi a un amico di inviarti token!\n");
+                    printf("✅ Registrazione in coda (Saldo: 0). Chiedi a un amico di inviarti token!\n");
                     save_wallet_to_disk();
                 }
                 break;
@@ -564,12 +747,16 @@ int main() {
                     break;
                 }
                 if (id >= 0 && id < global_wallet.count) {
-                    UserState *u = state_get_user(global_wallet.entries[id].pub);
-                    
-                    if (u) {
-                        if (user_login(global_wallet.entries[id].priv, global_wallet.entries[id].pub)) {
-                            current_user_idx = id;
-                        }
+                    SignSession *signer = wallet_session(id);
+                    if (!signer) break;
+
+                    chain_lock();
+                    int known = state_get_user(global_wallet.entries[id].pub) != NULL;
+                    int logged = known && user_login(signer, global_wallet.entries[id].pub);
+                    chain_unlock();
+
+                    if (known) {
+                        if (logged) current_user_idx = id;
                     } else {
                         printf("[LOGIN] ⚠️ Utente locale non ancora sulla blockchain.\n");
                         printf("         Accesso consentito SOLO per completare la registrazione (Opzione [2]).\n");
@@ -593,11 +780,10 @@ int main() {
                 PayloadPost p;
                 snprintf(p.content, MAX_CONTENT_LEN, "%s", buffer);
                 
-                Block *b = user_post(last, &p, w->priv, w->pub);
-                if (b) {
-                    last = b;
-                    printf("📝 Post pubblicato! ID: %d\n", b->index);
-                }
+                chain_lock();
+                long t = user_post(&p, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
+                if (t > 0) printf("📝 L'ID del post sarà l'indice del blocco che lo include.\n");
                 break;
             }
             
@@ -625,8 +811,9 @@ int main() {
                 WalletEntry *w = &global_wallet.entries[current_user_idx];
                 PayloadReveal rev = {.target_post_id=target_id, .vote_value=vote_val};
                 snprintf(rev.salt_secret, sizeof(rev.salt_secret), "%.31s", buffer);
-                Block *b = user_like(last, &rev, w->priv, w->pub);
-                if (b) last = b;
+                chain_lock();
+                user_like(&rev, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
                 break;
             }
             case 6: { // REVEAL
@@ -653,8 +840,9 @@ int main() {
                 WalletEntry *w = &global_wallet.entries[current_user_idx];
                 PayloadReveal rev = {.target_post_id=target_id, .vote_value=vote_val};
                 snprintf(rev.salt_secret, sizeof(rev.salt_secret), "%.31s", buffer);
-                Block *b = user_reveal(last, &rev, w->priv, w->pub);
-                if (b) last = b;
+                chain_lock();
+                user_reveal(&rev, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
                 break;
             }
             case 7: { // FINALIZE
@@ -669,18 +857,21 @@ int main() {
                 WalletEntry *w = &global_wallet.entries[current_user_idx];
                 PayloadFinalize fin = { .target_post_id = target_id };
                 
-                // Chiamiamo la funzione che mina il blocco
-                Block *b = user_finalize(last, &fin, w->priv, w->pub);
-                if (b) last = b;
+                // Accodiamo la finalizzazione nel mempool
+                chain_lock();
+                user_finalize(&fin, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
                 break;
             }
             case 8: { // STATUS
                  printf("\n--- UTENTI NELLA BLOCKCHAIN ---\n");
+                 chain_lock();
                  // Qui iteriamo sul wallet locale per vedere i saldi dei nostri utenti
                  for(int i=0; i<global_wallet.count; i++) {
                      UserState *u = state_get_user(global_wallet.entries[i].pub);
                      if(u) printf("@%-10s | Bal: %3d | Streak: %d\n", u->username, u->token_balance, u->current_streak);
                  }
+                 chain_unlock();
                  break;
             }
             case 9: { // HACK
@@ -690,7 +881,9 @@ int main() {
                     while(getchar() != '\n');
                     break;
                 }
+                chain_lock();
                 time_travel_hack(target_id, 25);
+                chain_unlock();
                 break;
             }
 
@@ -711,8 +904,9 @@ int main() {
                 w->registered = 1; 
                 
                 // Selezioniamo subito questo utente
-                current_user_idx = global_wallet.count;
                 global_wallet.count++;
+                if (!wallet_session(global_wallet.count - 1)) break;
+                current_user_idx = global_wallet.count - 1;
                 
                 save_wallet_to_disk();
                 printf("👑 Wallet GOD importato con successo! Sei loggato come Creator.\n");
@@ -738,11 +932,9 @@ int main() {
                 p.target_post_id = target_id;
                 snprintf(p.content, MAX_CONTENT_LEN, "%s", buffer);
                 
-                Block *b = user_comment(last, &p, w->priv, w->pub);
-                if (b) {
-                    last = b;
-                    printf("💬 Commento pubblicato! ID: %d\n", b->index);
-                }
+                chain_lock();
+                user_comment(&p, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
                 break;
             }
             case 12: { // FOLLOW
@@ -760,11 +952,10 @@ int main() {
                 // Legge al massimo (SIGNATURE_LEN - 1) caratteri da buffer.
                 snprintf(p.target_user_pubkey, SIGNATURE_LEN, "%.*s", SIGNATURE_LEN - 1, buffer);
                 
-                Block *b = user_follow(last, &p, w->priv, w->pub);
-                if (b) {
-                    last = b;
-                    printf("➕ Ora segui l'utente con PubKey: %.16s...\n", buffer);
-                }
+                chain_lock();
+                long t = user_follow(&p, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
+                if (t > 0) printf("➕ Follow in coda per la PubKey: %.16s...\n", buffer);
                 break;
             }
             case 13: { // MOSTRA COMMENTI
@@ -775,12 +966,38 @@ int main() {
                     break;
                 }
                 
+                chain_lock();
                 PostState *p = post_index_get(target_id);
                 if (!p) {
+                    chain_unlock();
                     printf("❌ Post #%d non trovato.\n", target_id);
                     break;
                 }
 
+                // Contenuto originale letto dal ledger tramite l'indice (nessuna scansione).
+                // Un post minato insieme ad altre azioni è l'unico post del suo batch.
+                Block post_block = {0};
+                const char *post_author = NULL;
+                const PayloadPost *post_body = NULL;
+                if (get_block_by_index(target_id, &post_block)) {
+                    if (post_block.type == ACT_POST_CONTENT) {
+                        post_author = post_block.sender_pubkey;
+                        post_body = &post_block.data.post;
+                    } else if (post_block.type == ACT_BATCH) {
+                        for (int i = 0; i < post_block.data.batch.count; i++) {
+                            if (post_block.actions[i].type != ACT_POST_CONTENT) continue;
+                            post_author = post_block.actions[i].sender_pubkey;
+                            post_body = &post_block.actions[i].data.post;
+                            break;
+                        }
+                    }
+                }
+                if (post_body) {
+                    UserState *author = state_get_user(post_author);
+                    printf("\n📢 @%s: %s\n", author ? author->username : "Unknown", post_body->content);
+                }
+                block_release(&post_block);
+
                 printf("\n--- COMMENTI SU POST #%d ---\n", target_id);
                 
                 CommentNode *curr = p->comments;
@@ -790,13 +1007,14 @@ int main() {
                 
                 while(curr) {
                     // Recuperiamo l'username se possibile
-                    UserState *u = state_get_user(curr->author_pubkey);
+                    UserState *u = state_user_by_id(curr->author_id);
                     char *name = u ? u->username : "Unknown";
                     
                     printf("💬 @%s: %s\n", name, curr->content);
                     curr = curr->next;
                 }
                 printf("----------------------------\n");
+                chain_unlock();
                 break;
             }
             case 14: { // GIFT TOKENS
@@ -816,13 +1034,13 @@ int main() {
                 getchar(); // Consuma newline
 
                 WalletEntry *w = &global_wallet.entries[current_user_idx];
-                PayloadTransfer t;
-                snprintf(t.target_pubkey, SIGNATURE_LEN, "%s", target_pub);
-                t.amount = amount;
+                PayloadTransfer tr;
+                snprintf(tr.target_pubkey, SIGNATURE_LEN, "%s", target_pub);
+                tr.amount = amount;
 
-                // Chiamata alla nuova funzione (che creeremo in user.c)
-                Block *b = user_transfer(last, &t, w->priv, w->pub);
-                if (b) last = b;
+                chain_lock();
+                user_transfer(&tr, wallet_sessions[current_user_idx], w->pub);
+                chain_unlock();
                 break;
             }
             case 15: { // BUY TOKENS (SIMULATION)
@@ -831,13 +1049,16 @@ int main() {
                     break;
                 }
 
+                chain_lock();
                 float mult = get_economy_multiplier();
+                long long circulating = global_tokens_circulating;
+                chain_unlock();
                 int price_10 = (int)(10 * COSTO_TOKEN_BASE * mult);
                 int price_50 = (int)(50 * COSTO_TOKEN_BASE * mult);
                 
                 printf("\n=== 🏦 WWYL EXCHANGE (DEX) ===\n");
                 printf("📊 Indice Scarsità Attuale: %.2fx\n", mult);
-                printf("💰 Token in Circolazione: %lld / %d\n", global_tokens_circulating, GLOBAL_TOKEN_LIMIT);
+                printf("💰 Token in Circolazione: %lld / %d\n", circulating, GLOBAL_TOKEN_LIMIT);
                 printf("-------------------------------\n");
                 printf("[1]  10 Token  → %d coin\n", price_10);
                 printf("[2]  50 Token  → %d coin\n", price_50);
@@ -877,20 +1098,70 @@ int main() {
 
                 // Esegui acquisto
                 WalletEntry *w = &global_wallet.entries[current_user_idx];
+                chain_lock();
                 buy_tokens_sim(w->pub, amount);
+                chain_unlock();
                 
                 // Salviamo lo stato del wallet su disco per sicurezza
                 save_wallet_to_disk();
                 break;
             }
+            case 16: { // MEMPOOL
+                printf("📬 Mempool: %d azioni in attesa di un blocco.\n", mempool_pending());
+                break;
+            }
+            case 17: { // FLUSH
+                if (mempool_pending() == 0) { printf("Nessuna azione in sospeso.\n"); break; }
+                printf("⏳ Attendo il miner...\n");
+                mempool_flush();
+                break;
+            }
+            case 18: { // PROVA DI INCLUSIONE
+                printf("ID Blocco: ");
+                if (scanf("%d", &target_id) != 1) {
+                    printf("Input non valido.\n");
+                    while(getchar() != '\n');
+                    break;
+                }
+                MmrProof proof;
+                Block blk = {0};
+                uint8_t root[HASH_SIZE];
+                chain_lock();
+                int ok = mmr_prove(target_id, &proof) && mmr_root(root) && get_block_by_index(target_id, &blk);
+                chain_unlock();
+                block_release(&blk); // Qui serve solo l'header
+                if (!ok) { printf("❌ Blocco #%d non presente nell'accumulatore.\n", target_id); break; }
+
+                char hex[HASH_LEN];
+                hex_encode(root, HASH_SIZE, hex);
+                printf("\n🌳 MMR Root (%ld blocchi): %s\n", proof.leaf_count, hex);
+                hex_encode(blk.curr_hash, HASH_SIZE, hex);
+                printf("🍃 Foglia #%ld: %s\n", proof.leaf_index, hex);
+                for (int i = 0; i < proof.path_len; i++) {
+                    hex_encode(proof.path[i], HASH_SIZE, hex);
+                    printf("   ↳ fratello %2d: %.16s...\n", i, hex);
+                }
+                printf("   + %d picchi\n", proof.peak_count);
+                if (mmr_verify(blk.curr_hash, &proof, root)) {
+                    printf("✅ Blocco #%d incluso nella chain (%d hash nella prova).\n", target_id, proof.path_len + proof.peak_count);
+                } else {
+                    printf("❌ Prova di inclusione NON valida per il blocco #%d!\n", target_id);
+                }
+                break;
+            }
             case 0: // EXIT
-                save_blockchain(blockchain); // Salva Ledger
+                // Le azioni accodate non sopravvivono alla sessione: il miner
+                // le svuota prima di fermarsi
+                mempool_stop();
+                for (int i = 0; i < 10; i++) sign_session_free(wallet_sessions[i]);
+                save_blockchain(mempool_tip()); // Chiude il Ledger
                 save_wallet_to_disk();       // Salva Chiavi
                 
                 // Cleanup Memoria
                 free_blockchain(blockchain);
                 state_cleanup();
                 post_index_cleanup();
+                crypto_cleanup();
                 EVP_cleanup();
                 
                 // Pulisce le chiavi in RAM prima di uscire (Security)
@@ -900,4 +1171,5 @@ int main() {
                 return 0;
         }
     }
-}
\ No newline at end of file
+}
+#endif
@@ -1,17 +1,7 @@
 #include "wwyl_crypto.h"
-
-// --- HELPER: Padding Hex (Invariato) ---
-void pad_hex(const char* input_hex, char* output_fixed_64) {
-    int len = strlen(input_hex);
-    int padding = 64 - len;
-    if (padding < 0) {
-        strncpy(output_fixed_64, input_hex, 64);
-    } else {
-        for (int i = 0; i < padding; i++) output_fixed_64[i] = '0';
-        strcpy(output_fixed_64 + padding, input_hex);
-    }
-    output_fixed_64[64] = '\0';
-}
+#include "wwyl.h"
+#include "hex.h"
+#include <pthread.h>
 
 // --- HELPER: Gestione Errori OpenSSL ---
 void handle_openssl_error() {
@@ -19,49 +9,92 @@ void handle_openssl_error() {
     abort();
 }
 
-// Hashing SHA256 (Moderno con EVP)
-void sha256_hash(const char *input, size_t len, char *output_hex) {
-    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
-    unsigned char hash[EVP_MAX_MD_SIZE];
-    unsigned int hash_len;
+// ---------------------------------------------------------
+// CONTESTI DIGEST RIUSABILI
+// ---------------------------------------------------------
+// EVP_sha256() in OpenSSL 3 fa un fetch implicito dell'algoritmo a ogni init
+// e EVP_Digest alloca un contesto a ogni chiamata: l'algoritmo si recupera
+// una volta sola e ogni thread tiene il proprio EVP_MD_CTX (liberato
+// all'uscita del thread dal distruttore della chiave).
+static EVP_MD *sha256_md = NULL;
+static pthread_key_t md_ctx_key;
+static pthread_once_t md_once = PTHREAD_ONCE_INIT;
 
-    if(!mdctx) handle_openssl_error();
+static void md_ctx_destroy(void *ctx) {
+    EVP_MD_CTX_free(ctx);
+}
 
-    EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL);
-    EVP_DigestUpdate(mdctx, input, len);
-    EVP_DigestFinal_ex(mdctx, hash, &hash_len);
-    EVP_MD_CTX_free(mdctx);
+static void md_init(void) {
+    sha256_md = EVP_MD_fetch(NULL, "SHA256", NULL);
+    if (!sha256_md || pthread_key_create(&md_ctx_key, md_ctx_destroy) != 0) handle_openssl_error();
+}
+
+static const EVP_MD *md_sha256(void) {
+    pthread_once(&md_once, md_init);
+    return sha256_md;
+}
 
-    for(unsigned int i = 0; i < hash_len; i++) {
-        sprintf(output_hex + (i * 2), "%02x", hash[i]);
+static EVP_MD_CTX *thread_md_ctx(void) {
+    pthread_once(&md_once, md_init);
+    EVP_MD_CTX *ctx = pthread_getspecific(md_ctx_key);
+    if (!ctx) {
+        ctx = EVP_MD_CTX_new();
+        if (!ctx || pthread_setspecific(md_ctx_key, ctx) != 0) handle_openssl_error();
     }
-    output_hex[hash_len * 2] = '\0';
+    return ctx;
+}
+
+// Hashing SHA256 (Moderno con EVP)
+void sha256_hash(const char *input, size_t len, char *output_hex) {
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    sha256_raw(input, len, hash);
+    hex_encode(hash, SHA256_DIGEST_LENGTH, output_hex);
+}
+
+// Hashing SHA256 con output binario (32 byte, nessuna conversione hex)
+void sha256_raw(const void *input, size_t len, uint8_t *output) {
+    EVP_MD_CTX *ctx = thread_md_ctx();
+    if (!EVP_DigestInit_ex2(ctx, md_sha256(), NULL) || !EVP_DigestUpdate(ctx, input, len)
+        || !EVP_DigestFinal_ex(ctx, output, NULL)) {
+        handle_openssl_error();
+    }
+}
+
+// Hex di una chiave in binario: lunghezza pari, al massimo 'cap' byte.
+// Ritorna i byte scritti, 0 se la stringa non è una chiave esadecimale.
+static size_t key_from_hex(const char *hex, uint8_t *out, size_t cap) {
+    size_t len = strlen(hex);
+    if (len == 0 || len % 2 != 0 || len / 2 > cap || !hex_decode(hex, out, len / 2)) return 0;
+    return len / 2;
 }
 
 // --- HELPER: Costruzione Chiave da Hex (La parte difficile di OpenSSL 3.0) ---
-// Converte la stringa Hex in un oggetto EVP_PKEY usabile
+// Converte la stringa Hex in un oggetto EVP_PKEY usabile. NULL se l'hex non è valido.
+// La privata è big-endian fino a PRIV_KEY_SIZE byte (BN_bn2hex omette gli zeri iniziali),
+// la pubblica è l'octet string del punto.
 EVP_PKEY* get_pkey_from_hex(const char *priv_hex, const char *pub_hex) {
+    uint8_t priv_bytes[PRIV_KEY_SIZE];
+    uint8_t pub_bytes[SIGNATURE_LEN / 2];   // Punto non compresso: 65 byte
+    size_t priv_len = 0, pub_len = 0;
+
+    if (priv_hex && !(priv_len = key_from_hex(priv_hex, priv_bytes, sizeof(priv_bytes)))) return NULL;
+    if (pub_hex && !(pub_len = key_from_hex(pub_hex, pub_bytes, sizeof(pub_bytes)))) return NULL;
+
     EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_from_name(NULL, "EC", NULL);
     EVP_PKEY *pkey = NULL;
     OSSL_PARAM_BLD *bld = OSSL_PARAM_BLD_new();
     OSSL_PARAM *params = NULL;
     BIGNUM *bn_priv = NULL;
-    unsigned char *pub_bytes = NULL;
 
     OSSL_PARAM_BLD_push_utf8_string(bld, "group", "secp256k1", 0);
 
     if (priv_hex) {
-        BN_hex2bn(&bn_priv, priv_hex);
+        bn_priv = BN_bin2bn(priv_bytes, (int)priv_len, NULL);
         OSSL_PARAM_BLD_push_BN(bld, "priv", bn_priv);
+        OPENSSL_cleanse(priv_bytes, sizeof(priv_bytes));
     }
 
     if (pub_hex) {
-        // La chiave pubblica in hex deve essere convertita in octet string
-        long pub_len = strlen(pub_hex) / 2;
-        pub_bytes = OPENSSL_malloc(pub_len);
-        for (long i = 0; i < pub_len; i++) {
-            sscanf(pub_hex + 2*i, "%2hhx", &pub_bytes[i]);
-        }
         OSSL_PARAM_BLD_push_octet_string(bld, "pub", pub_bytes, pub_len);
     }
 
@@ -71,8 +104,7 @@ EVP_PKEY* get_pkey_from_hex(const char *priv_hex, const char *pub_hex) {
     EVP_PKEY_fromdata(pctx, &pkey, EVP_PKEY_KEYPAIR, params);
 
     // Cleanup
-    if (bn_priv) BN_free(bn_priv);
-    if (pub_bytes) OPENSSL_free(pub_bytes);
+    if (bn_priv) BN_clear_free(bn_priv);
     OSSL_PARAM_free(params);
     OSSL_PARAM_BLD_free(bld);
     EVP_PKEY_CTX_free(pctx);
@@ -80,17 +112,156 @@ EVP_PKEY* get_pkey_from_hex(const char *priv_hex, const char *pub_hex) {
     return pkey;
 }
 
+// ---------------------------------------------------------
+// CACHE LRU DELLE CHIAVI PUBBLICHE
+// ---------------------------------------------------------
+// Ricostruire un EVP_PKEY da hex (OSSL_PARAM_BLD + EVP_PKEY_fromdata) costa
+// più della verifica stessa, e pochi utenti firmano la maggior parte dei
+// blocchi: le chiavi già viste restano in una cache a capacità fissa.
+// Tabella hash a catene di indici + lista doppiamente collegata per l'LRU.
+// Protetta da mutex (la verifica della chain è multithread): chi ottiene una
+// chiave riceve un proprio riferimento (EVP_PKEY_up_ref) e la libera da sé,
+// così un'eviction concorrente non la distrugge mentre è in uso.
+typedef struct {
+    char pub_hex[SIGNATURE_LEN];
+    EVP_PKEY *pkey;
+    int lru_prev, lru_next;  // -1 = estremo della lista
+    int bucket_next;         // -1 = fine catena
+} PkeyCacheEntry;
+
+static PkeyCacheEntry pkey_cache[PKEY_CACHE_SIZE];
+static int pkey_buckets[PKEY_CACHE_BUCKETS];
+static int pkey_cache_used = 0;
+static int pkey_lru_head = -1, pkey_lru_tail = -1;
+static pthread_mutex_t pkey_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t pkey_cache_once = PTHREAD_ONCE_INIT;
+
+static void pkey_cache_init(void) {
+    for (int i = 0; i < PKEY_CACHE_BUCKETS; i++) pkey_buckets[i] = -1;
+}
+
+static unsigned int pkey_bucket_of(const char *pub_hex) {
+    unsigned long h = 5381;
+    while (*pub_hex) h = ((h << 5) + h) + (unsigned char)*pub_hex++;
+    return (unsigned int)(h % PKEY_CACHE_BUCKETS);
+}
+
+static void lru_unlink(int i) {
+    PkeyCacheEntry *e = &pkey_cache[i];
+    if (e->lru_prev >= 0) pkey_cache[e->lru_prev].lru_next = e->lru_next;
+    else pkey_lru_head = e->lru_next;
+    if (e->lru_next >= 0) pkey_cache[e->lru_next].lru_prev = e->lru_prev;
+    else pkey_lru_tail = e->lru_prev;
+}
+
+static void lru_push_front(int i) {
+    PkeyCacheEntry *e = &pkey_cache[i];
+    e->lru_prev = -1;
+    e->lru_next = pkey_lru_head;
+    if (pkey_lru_head >= 0) pkey_cache[pkey_lru_head].lru_prev = i;
+    pkey_lru_head = i;
+    if (pkey_lru_tail < 0) pkey_lru_tail = i;
+}
+
+static int pkey_cache_find(const char *pub_hex, unsigned int bucket) {
+    for (int i = pkey_buckets[bucket]; i >= 0; i = pkey_cache[i].bucket_next) {
+        if (strcmp(pkey_cache[i].pub_hex, pub_hex) == 0) return i;
+    }
+    return -1;
+}
+
+static void pkey_bucket_remove(int i) {
+    int *link = &pkey_buckets[pkey_bucket_of(pkey_cache[i].pub_hex)];
+    while (*link != i) link = &pkey_cache[*link].bucket_next;
+    *link = pkey_cache[i].bucket_next;
+}
+
+// Ritorna un riferimento proprio del chiamante (da liberare con EVP_PKEY_free)
+static EVP_PKEY *get_cached_pubkey(const char *pub_hex) {
+    if (strlen(pub_hex) >= SIGNATURE_LEN) return get_pkey_from_hex(NULL, pub_hex);
+
+    pthread_once(&pkey_cache_once, pkey_cache_init);
+    unsigned int bucket = pkey_bucket_of(pub_hex);
+
+    pthread_mutex_lock(&pkey_cache_lock);
+    int i = pkey_cache_find(pub_hex, bucket);
+    if (i >= 0) {
+        lru_unlink(i);
+        lru_push_front(i);
+        EVP_PKEY *hit = pkey_cache[i].pkey;
+        EVP_PKEY_up_ref(hit);
+        pthread_mutex_unlock(&pkey_cache_lock);
+        return hit;
+    }
+    pthread_mutex_unlock(&pkey_cache_lock);
+
+    // Il parsing avviene fuori dal lock: gli altri thread non restano bloccati
+    EVP_PKEY *pkey = get_pkey_from_hex(NULL, pub_hex);
+    if (!pkey) return NULL; // Le chiavi non valide non entrano in cache
+
+    pthread_mutex_lock(&pkey_cache_lock);
+    i = pkey_cache_find(pub_hex, bucket);
+    if (i >= 0) {
+        // Un altro thread l'ha inserita nel frattempo
+        EVP_PKEY_free(pkey);
+        pkey = pkey_cache[i].pkey;
+        lru_unlink(i);
+    } else {
+        if (pkey_cache_used < PKEY_CACHE_SIZE) {
+            i = pkey_cache_used++;
+        } else {
+            // Cache piena: si sacrifica la chiave usata meno di recente
+            i = pkey_lru_tail;
+            lru_unlink(i);
+            pkey_bucket_remove(i);
+            EVP_PKEY_free(pkey_cache[i].pkey);
+        }
+        snprintf(pkey_cache[i].pub_hex, sizeof(pkey_cache[i].pub_hex), "%s", pub_hex);
+        pkey_cache[i].pkey = pkey;
+        pkey_cache[i].bucket_next = pkey_buckets[bucket];
+        pkey_buckets[bucket] = i;
+    }
+    lru_push_front(i);
+    EVP_PKEY_up_ref(pkey);
+    pthread_mutex_unlock(&pkey_cache_lock);
+    return pkey;
+}
+
+void pkey_cache_clear(void) {
+    pthread_mutex_lock(&pkey_cache_lock);
+    for (int i = 0; i < pkey_cache_used; i++) EVP_PKEY_free(pkey_cache[i].pkey);
+    pkey_cache_used = 0;
+    pkey_lru_head = pkey_lru_tail = -1;
+    pkey_cache_init();
+    pthread_mutex_unlock(&pkey_cache_lock);
+}
+
+// Da chiamare all'uscita, quando gli altri thread sono già terminati
+void crypto_cleanup(void) {
+    pkey_cache_clear();
+    if (sha256_md) {
+        EVP_MD_CTX_free(pthread_getspecific(md_ctx_key));
+        pthread_setspecific(md_ctx_key, NULL);
+        EVP_MD_free(sha256_md);
+        sha256_md = NULL;
+    }
+}
+
 // Generazione Keypair (OpenSSL 3.0 Way)
 void generate_keypair(char *priv_hex_out, char *pub_hex_out) {
     // Generazione facile in una riga (Feature di OpenSSL 3.0)
     EVP_PKEY *pkey = EVP_PKEY_Q_keygen(NULL, NULL, "EC", "secp256k1");
     if (!pkey) handle_openssl_error();
 
-    // Estrazione Private Key (Big Number)
+    // Estrazione Private Key (Big Number), sempre su PRIV_KEY_SIZE byte
     BIGNUM *priv_bn = NULL;
-    EVP_PKEY_get_bn_param(pkey, "priv", &priv_bn);
-    char *hex_priv = BN_bn2hex(priv_bn);
-    strcpy(priv_hex_out, hex_priv);
+    uint8_t priv_bytes[PRIV_KEY_SIZE];
+    if (!EVP_PKEY_get_bn_param(pkey, "priv", &priv_bn)
+        || BN_bn2binpad(priv_bn, priv_bytes, sizeof(priv_bytes)) != (int)sizeof(priv_bytes)) {
+        handle_openssl_error();
+    }
+    hex_encode_upper(priv_bytes, sizeof(priv_bytes), priv_hex_out);
+    OPENSSL_cleanse(priv_bytes, sizeof(priv_bytes));
 
     // Estrazione Public Key (Octet String)
     unsigned char pub_buf[128];
@@ -100,92 +271,142 @@ void generate_keypair(char *priv_hex_out, char *pub_hex_out) {
     // Otteniamo i dati
     EVP_PKEY_get_octet_string_param(pkey, "pub", pub_buf, sizeof(pub_buf), &pub_len);
 
-    // Convertiamo buffer binario in Hex String
-    for(size_t i=0; i<pub_len; i++) {
-        sprintf(pub_hex_out + (i*2), "%02X", pub_buf[i]);
-    }
-    pub_hex_out[pub_len*2] = '\0';
+    // Convertiamo buffer binario in Hex String (maiuscolo, come BN_bn2hex)
+    hex_encode_upper(pub_buf, pub_len, pub_hex_out);
 
     // Cleanup
-    OPENSSL_free(hex_priv);
-    BN_free(priv_bn);
+    BN_clear_free(priv_bn);
     EVP_PKEY_free(pkey);
 }
 
-// Firma ECDSA (EVP Interface)
-void ecdsa_sign(const char *private_key_hex, const char *message, char *signature_hex) {
-    EVP_PKEY *pkey = get_pkey_from_hex(private_key_hex, NULL);
-    if (!pkey) handle_openssl_error();
+// ---------------------------------------------------------
+// FIRMA BINARIA <-> DER
+// ---------------------------------------------------------
+// OpenSSL firma e verifica in DER: SEQUENCE { INTEGER r, INTEGER s }.
+// La conversione da e verso r || s si fa a mano, senza BIGNUM né ECDSA_SIG.
+// Gli INTEGER DER sono minimi e con segno: niente zeri iniziali superflui,
+// uno 0x00 davanti se il primo byte ha il bit alto acceso.
+#define DER_SIG_MAX 72
 
-    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
-    
-    // Inizializza firma con SHA256
-    EVP_DigestSignInit(mdctx, NULL, EVP_sha256(), NULL, pkey);
-    
-    // Calcola firma (output è in formato DER binario)
-    size_t sig_len = 0;
-    EVP_DigestSign(mdctx, NULL, &sig_len, (unsigned char*)message, strlen(message));
-    unsigned char *sig_buf = OPENSSL_malloc(sig_len);
-    EVP_DigestSign(mdctx, sig_buf, &sig_len, (unsigned char*)message, strlen(message));
-
-    // Decodifica DER per estrarre R e S (per avere la stringa fissa 64+64)
-    // Usiamo d2i_ECDSA_SIG che non è deprecata per il parsing dei dati grezzi
-    const unsigned char *p = sig_buf;
-    ECDSA_SIG *ecdsa_sig = d2i_ECDSA_SIG(NULL, &p, sig_len);
-    
-    const BIGNUM *r = ECDSA_SIG_get0_r(ecdsa_sig);
-    const BIGNUM *s = ECDSA_SIG_get0_s(ecdsa_sig);
+static size_t der_put_int(const uint8_t *v, uint8_t *out) {
+    size_t skip = 0;
+    while (skip < SIG_SIZE / 2 - 1 && v[skip] == 0) skip++;
+    size_t len = SIG_SIZE / 2 - skip;
+    size_t pad = (v[skip] & 0x80) ? 1 : 0;
+    out[0] = 0x02;
+    out[1] = (uint8_t)(len + pad);
+    out[2] = 0x00;
+    memcpy(out + 2 + pad, v + skip, len);
+    return 2 + pad + len;
+}
 
-    char *r_hex = BN_bn2hex(r);
-    char *s_hex = BN_bn2hex(s);
-    
-    char r_fixed[65], s_fixed[65];
-    pad_hex(r_hex, r_fixed);
-    pad_hex(s_hex, s_fixed);
-    
-    sprintf(signature_hex, "%s%s", r_fixed, s_fixed);
+static size_t sig_to_der(const uint8_t *signature, uint8_t *der) {
+    size_t n = der_put_int(signature, der + 2);
+    n += der_put_int(signature + SIG_SIZE / 2, der + 2 + n);
+    der[0] = 0x30;
+    der[1] = (uint8_t)n;
+    return n + 2;
+}
 
-    // Cleanup
-    OPENSSL_free(r_hex); OPENSSL_free(s_hex);
-    OPENSSL_free(sig_buf);
-    ECDSA_SIG_free(ecdsa_sig);
-    EVP_MD_CTX_free(mdctx);
-    EVP_PKEY_free(pkey);
+static int der_get_int(const uint8_t **p, const uint8_t *end, uint8_t *out) {
+    if (end - *p < 2 || (*p)[0] != 0x02) return 0;
+    size_t len = (*p)[1];
+    const uint8_t *v = *p + 2;
+    if (len == 0 || (size_t)(end - v) < len) return 0;
+    *p = v + len;
+    while (len > SIG_SIZE / 2 && *v == 0) { v++; len--; }   // Zero di segno
+    if (len > SIG_SIZE / 2) return 0;
+    memset(out, 0, SIG_SIZE / 2 - len);
+    memcpy(out + SIG_SIZE / 2 - len, v, len);
+    return 1;
 }
 
-// Verifica ECDSA
-void ecdsa_verify(const char *public_key_hex, const char *message, const char *signature_hex, int *is_valid) {
-    EVP_PKEY *pkey = get_pkey_from_hex(NULL, public_key_hex);
-    if (!pkey) { *is_valid = 0; return; }
+static int der_to_sig(const uint8_t *der, size_t der_len, uint8_t *signature) {
+    if (der_len < 2 || der[0] != 0x30 || der[1] != der_len - 2) return 0;
+    const uint8_t *p = der + 2, *end = der + der_len;
+    return der_get_int(&p, end, signature) && der_get_int(&p, end, signature + SIG_SIZE / 2) && p == end;
+}
+
+// ---------------------------------------------------------
+// SESSIONE DI FIRMA
+// ---------------------------------------------------------
+// La chiave privata viene decodificata una volta sola e il contesto di firma
+// (SHA256 + chiave) inizializzato una volta: ogni firma parte da una copia
+// del contesto già pronto. Il mutex serve perché la stessa identità firma
+// sia dalla CLI (login) sia dal thread del miner.
+struct SignSession {
+    EVP_PKEY *pkey;
+    EVP_MD_CTX *ready;   // Dopo EVP_DigestSignInit: modello per ogni firma
+    EVP_MD_CTX *work;
+    pthread_mutex_t lock;
+};
+
+SignSession *sign_session_new(const char *private_key_hex) {
+    EVP_PKEY *pkey = get_pkey_from_hex(private_key_hex, NULL);
+    if (!pkey) return NULL;
+
+    SignSession *s = OPENSSL_zalloc(sizeof(SignSession));
+    if (!s) handle_openssl_error();
+    pthread_mutex_init(&s->lock, NULL);
+    s->pkey = pkey;
+    s->ready = EVP_MD_CTX_new();
+    s->work = EVP_MD_CTX_new();
+    if (!s->ready || !s->work || EVP_DigestSignInit(s->ready, NULL, md_sha256(), NULL, pkey) != 1) {
+        sign_session_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void sign_session_free(SignSession *s) {
+    if (!s) return;
+    pthread_mutex_destroy(&s->lock);
+    EVP_MD_CTX_free(s->ready);
+    EVP_MD_CTX_free(s->work);
+    EVP_PKEY_free(s->pkey);
+    OPENSSL_free(s);
+}
 
-    // Ricostruzione Firma DER da R e S Hex
-    char r_str[65], s_str[65];
-    strncpy(r_str, signature_hex, 64); r_str[64] = '\0';
-    strncpy(s_str, signature_hex+64, 64); s_str[64] = '\0';
+void sign_session_sign(SignSession *s, const char *message, uint8_t *signature) {
+    unsigned char der[DER_SIG_MAX];
+    size_t der_len = sizeof(der);
 
-    BIGNUM *r = NULL, *s = NULL;
-    BN_hex2bn(&r, r_str);
-    BN_hex2bn(&s, s_str);
+    pthread_mutex_lock(&s->lock);
+    if (!EVP_MD_CTX_copy_ex(s->work, s->ready)
+        || EVP_DigestSign(s->work, der, &der_len, (const unsigned char *)message, strlen(message)) != 1) {
+        handle_openssl_error();
+    }
+    pthread_mutex_unlock(&s->lock);
 
-    ECDSA_SIG *ecdsa_sig = ECDSA_SIG_new();
-    ECDSA_SIG_set0(ecdsa_sig, r, s);
+    // Decodifica DER per estrarre R e S (per avere la firma fissa 32+32 byte)
+    if (!der_to_sig(der, der_len, signature)) handle_openssl_error();
+}
+
+// Firma ECDSA (EVP Interface): sessione usa e getta, per le firme isolate
+void ecdsa_sign(const char *private_key_hex, const char *message, uint8_t *signature) {
+    SignSession *s = sign_session_new(private_key_hex);
+    if (!s) handle_openssl_error();
+    sign_session_sign(s, message, signature);
+    sign_session_free(s);
+}
+
+// Verifica ECDSA
+void ecdsa_verify(const char *public_key_hex, const char *message, const uint8_t *signature, int *is_valid) {
+    EVP_PKEY *pkey = get_cached_pubkey(public_key_hex);
+    if (!pkey) { *is_valid = 0; return; }
 
-    // Encoding DER (necessario per EVP_DigestVerify)
-    int der_len = i2d_ECDSA_SIG(ecdsa_sig, NULL);
-    unsigned char *der_sig = OPENSSL_malloc(der_len);
-    unsigned char *p = der_sig;
-    i2d_ECDSA_SIG(ecdsa_sig, &p);
+    // Firma DER da R e S binari (necessaria per EVP_DigestVerify)
+    uint8_t der_sig[DER_SIG_MAX];
+    size_t der_len = sig_to_der(signature, der_sig);
 
     // Verifica effettiva
     EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
-    EVP_DigestVerifyInit(mdctx, NULL, EVP_sha256(), NULL, pkey);
+    EVP_DigestVerifyInit(mdctx, NULL, md_sha256(), NULL, pkey);
     
     int result = EVP_DigestVerify(mdctx, der_sig, der_len, (unsigned char*)message, strlen(message));
     *is_valid = (result == 1);
 
     // Cleanup
-    OPENSSL_free(der_sig);
-    ECDSA_SIG_free(ecdsa_sig);
     EVP_MD_CTX_free(mdctx);
     EVP_PKEY_free(pkey);
 }
\ No newline at end of file